@@ -0,0 +1,542 @@
+#define _USE_MATH_DEFINES
+
+#include "tasks.h"
+#include "Parallel.h"
+#include "Picking.h"
+#include "CurveBvh.h"
+#include "CurveSet.h"
+#include "SceneFile.h"
+#include "SceneText.h"
+#include "SinCos.h"
+#include "Tessellation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Usage: lich_bench [--sizes 1000,1000000,10000000] [--format csv|json]
+//                   [--min-time seconds] [--filter substring]
+//                   [--threads 1,2,4,...] [--seed n]
+//
+// Prints one line per benchmark and scene size, as CSV with a header or as
+// JSON lines. ns_per_op is wall time per operation: one evaluated point for
+// the evaluation benchmarks, one curve for tessellation and the tasks.
+// points_per_s counts evaluated or emitted points and is left empty for the
+// tasks, which produce none. Scenes come from the seeded Task1, so every
+// run measures the same curves. Every size is run once per entry of
+// --threads, which makes a scaling table; 0 (the default) uses all cores.
+
+namespace
+{
+    // Parameter values evaluated on every curve by the evaluation benchmarks
+    const int SamplesPerCurve = 16;
+    // Segments for the uniform tessellation benchmarks
+    const int UniformSegments = 64;
+    // CurveSet::tessellate keeps all polylines at once; larger scenes skip it
+    const size_t MaxTessellationBytes = size_t(1) << 30;
+
+    struct Options
+    {
+        std::vector<size_t> sizes{ 1000, 1000000, 10000000 };
+        bool json = false;
+        double minTime = 0.5;
+        std::string filter;
+        std::vector<size_t> threads{ 0 };
+        uint64_t seed = 1;
+    };
+
+    // Work done by one run of a benchmark body
+    struct Work
+    {
+        uint64_t ops;
+        uint64_t points;
+    };
+
+    struct Result
+    {
+        const char* name;
+        size_t curves;
+        unsigned threads;
+        int repetitions;
+        double seconds;
+        Work work;
+    };
+
+    // Results are folded in here so the optimizer cannot drop the measured work
+    volatile double sink;
+
+    // Comma-separated counts; zero only if allowZero
+    std::vector<size_t> ParseList(const std::string& option, const std::string& text, bool allowZero)
+    {
+        std::vector<size_t> sizes;
+        size_t first = 0;
+        while (first <= text.size())
+        {
+            size_t last = text.find(',', first);
+            if (last == std::string::npos)
+                last = text.size();
+            std::string item = text.substr(first, last - first);
+            if (item.empty() || item.find_first_not_of("0123456789") != std::string::npos || (!allowZero && std::stoull(item) == 0))
+                throw std::invalid_argument("bad value in " + option + ": " + text);
+            sizes.push_back((size_t)std::stoull(item));
+            first = last + 1;
+        }
+        return sizes;
+    }
+
+    Options ParseOptions(int argc, char** argv)
+    {
+        Options options;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (i + 1 >= argc)
+                throw std::invalid_argument("missing value for " + arg);
+            std::string value = argv[++i];
+
+            if (arg == "--sizes")
+                options.sizes = ParseList(arg, value, false);
+            else if (arg == "--format" && (value == "csv" || value == "json"))
+                options.json = value == "json";
+            else if (arg == "--min-time")
+                options.minTime = std::stod(value);
+            else if (arg == "--filter")
+                options.filter = value;
+            else if (arg == "--threads")
+                options.threads = ParseList(arg, value, true);
+            else if (arg == "--seed")
+                options.seed = std::stoull(value);
+            else
+                throw std::invalid_argument("unknown option " + arg + " " + value);
+        }
+        return options;
+    }
+
+    void PrintHeader(const Options& options)
+    {
+        if (!options.json)
+            std::printf("benchmark,curves,threads,repetitions,ops,points,seconds,ns_per_op,points_per_s\n");
+    }
+
+    void Print(const Options& options, const Result& r)
+    {
+        uint64_t ops = r.work.ops * r.repetitions;
+        uint64_t points = r.work.points * r.repetitions;
+        double nsPerOp = ops ? r.seconds * 1e9 / ops : 0.0;
+
+        if (options.json)
+        {
+            std::printf("{\"benchmark\":\"%s\",\"curves\":%zu,\"threads\":%u,\"repetitions\":%d,\"ops\":%llu,\"points\":%llu,"
+                "\"seconds\":%.6f,\"ns_per_op\":%.3f,\"points_per_s\":",
+                r.name, r.curves, r.threads, r.repetitions, (unsigned long long)ops, (unsigned long long)points, r.seconds, nsPerOp);
+            if (points)
+                std::printf("%.0f}\n", points / r.seconds);
+            else
+                std::printf("null}\n");
+        }
+        else
+        {
+            std::printf("%s,%zu,%u,%d,%llu,%llu,%.6f,%.3f,", r.name, r.curves, r.threads, r.repetitions,
+                (unsigned long long)ops, (unsigned long long)points, r.seconds, nsPerOp);
+            if (points)
+                std::printf("%.0f\n", points / r.seconds);
+            else
+                std::printf("\n");
+        }
+        std::fflush(stdout);
+    }
+
+    bool Selected(const Options& options, const char* name)
+    {
+        return options.filter.empty() || std::string(name).find(options.filter) != std::string::npos;
+    }
+
+    // Repeats body until minTime has passed, at least once
+    template <class Body>
+    void Run(const Options& options, const char* name, size_t curves, unsigned threads, Body body)
+    {
+        if (!Selected(options, name))
+            return;
+
+        using Clock = std::chrono::steady_clock;
+        Result result{ name, curves, ResolveThreadCount(threads), 0, 0.0, { 0, 0 } };
+        Clock::time_point start = Clock::now();
+        do
+        {
+            result.work = body();
+            ++result.repetitions;
+            result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (result.seconds < options.minTime);
+
+        Print(options, result);
+    }
+
+    void RunObjectBenchmarks(const Options& options, size_t count, unsigned threads)
+    {
+        std::vector<std::shared_ptr<Curve3D>> curves;
+        Run(options, "task1_objects", count, threads, [&] {
+            Task1_GenerateRandomCurves(curves, (int)count, options.seed, threads);
+            return Work{ count, 0 };
+        });
+        if (curves.size() != count)
+            Task1_GenerateRandomCurves(curves, (int)count, options.seed, threads);
+
+        // The same scene from an arena, each worker on a heap of its own;
+        // every repetition after the first recycles the previous one's chunks
+        {
+            CurveArena arena;
+            std::vector<std::shared_ptr<Curve3D>> pooled;
+            Run(options, "task1_objects_arena", count, threads, [&] {
+                pooled.clear();
+                arena.reset();
+                Task1_GenerateRandomCurves(pooled, (int)count, options.seed, threads, &arena);
+                return Work{ count, 0 };
+            });
+        }
+
+        std::vector<double> ts(SamplesPerCurve);
+        for (int i = 0; i < SamplesPerCurve; ++i)
+            ts[i] = 2.0 * M_PI * i / SamplesPerCurve;
+        const uint64_t samples = (uint64_t)count * SamplesPerCurve;
+
+        Run(options, "getPoint", count, threads, [&] {
+            double sum = 0.0;
+            for (const auto& curve : curves)
+                for (double t : ts)
+                    sum += curve->getPoint(t).x;
+            sink = sum;
+            return Work{ samples, samples };
+        });
+
+        Run(options, "getDerivative", count, threads, [&] {
+            double sum = 0.0;
+            for (const auto& curve : curves)
+                for (double t : ts)
+                    sum += curve->getDerivative(t).x;
+            sink = sum;
+            return Work{ samples, samples };
+        });
+
+        Run(options, "evaluate", count, threads, [&] {
+            double sum = 0.0;
+            for (const auto& curve : curves)
+                for (double t : ts)
+                    sum += curve->evaluate(t).secondDerivative.x;
+            sink = sum;
+            return Work{ samples, samples };
+        });
+
+        Run(options, "evaluate_batch", count, threads, [&] {
+            std::vector<CurveSample> evaluated(SamplesPerCurve);
+            double sum = 0.0;
+            for (const auto& curve : curves)
+            {
+                curve->evaluate(ts, evaluated);
+                sum += evaluated[0].secondDerivative.x;
+            }
+            sink = sum;
+            return Work{ samples, samples };
+        });
+
+        Run(options, "frenetFrame_batch", count, threads, [&] {
+            std::vector<FrenetFrame> frames(SamplesPerCurve);
+            double sum = 0.0;
+            for (const auto& curve : curves)
+            {
+                curve->frenetFrame(ts, frames);
+                sum += frames[0].curvature;
+            }
+            sink = sum;
+            return Work{ samples, samples };
+        });
+
+        Run(options, "getPoints_batch", count, threads, [&] {
+            std::vector<Point3D> points(SamplesPerCurve);
+            double sum = 0.0;
+            for (const auto& curve : curves)
+            {
+                curve->getPoints(ts, points);
+                sum += points[0].x;
+            }
+            sink = sum;
+            return Work{ samples, samples };
+        });
+
+        // The first repetition also builds the ellipse arc-length tables;
+        // later ones measure a scene that is sampled repeatedly
+        Run(options, "getPointsByArcLength", count, threads, [&] {
+            std::vector<Point3D> points(SamplesPerCurve);
+            double sum = 0.0;
+            for (const auto& curve : curves)
+            {
+                curve->getPointsByArcLength(points);
+                sum += points[1].x;
+            }
+            sink = sum;
+            return Work{ samples, samples };
+        });
+
+        // One query point per curve, off the curve near its start
+        Run(options, "closestPoint", count, threads, [&] {
+            double sum = 0.0;
+            for (const auto& curve : curves)
+            {
+                Point3D p = curve->getPoint(0.3);
+                sum += curve->closestPoint(Point3D(p.x + 0.5, p.y - 0.25, p.z + 1.0)).t;
+            }
+            sink = sum;
+            return Work{ count, count };
+        });
+
+        // Spatial index: a full build, then small region queries and nearest
+        // curve lookups, per query. Task1 packs every curve around the origin,
+        // where a point is inside almost every box, so the index gets its own
+        // copy of the scene with the curves moved onto a lattice whose cells
+        // are a little smaller than the largest curves
+        if (Selected(options, "bvh_build") || Selected(options, "bvh_query_box") || Selected(options, "bvh_nearest")
+            || Selected(options, "bvh_closest_batch") || Selected(options, "bvh_pick"))
+        {
+            std::vector<std::shared_ptr<Curve3D>> spread;
+            Task1_GenerateRandomCurves(spread, (int)count, options.seed, threads);
+            const size_t side = (size_t)std::ceil(std::cbrt((double)count));
+            const double cell = 8.0;
+            for (size_t i = 0; i < count; ++i)
+                spread[i]->setPosition(Point3D(cell * (i % side), cell * (i / side % side), cell * (i / side / side)));
+
+            CurveBvh bvh;
+            Run(options, "bvh_build", count, threads, [&] {
+                bvh.build(spread, threads);
+                return Work{ count, 0 };
+            });
+            if (bvh.size() != count)
+                bvh.build(spread, threads);
+
+            const size_t queries = std::min<size_t>(count, 1000);
+            std::vector<uint32_t> found;
+            Run(options, "bvh_query_box", count, threads, [&] {
+                size_t hits = 0;
+                for (size_t q = 0; q < queries; ++q)
+                {
+                    Point3D c = spread[q * count / queries]->bounds().center();
+                    found.clear();
+                    bvh.query(Aabb{ Point3D(c.x - 1.0, c.y - 1.0, c.z - 1.0), Point3D(c.x + 1.0, c.y + 1.0, c.z + 1.0) },
+                        found);
+                    hits += found.size();
+                }
+                sink = (double)hits;
+                return Work{ queries, 0 };
+            });
+            Run(options, "bvh_nearest", count, threads, [&] {
+                long sum = 0;
+                for (size_t q = 0; q < queries; ++q)
+                    sum += ClosestPointInScene(bvh, spread, spread[q * count / queries]->bounds().center()).curve;
+                sink = (double)sum;
+                return Work{ queries, 0 };
+            });
+            // A dense grid of points through the lattice, one per curve,
+            // answered in one batch
+            std::vector<Point3D> grid(count);
+            for (size_t i = 0; i < count; ++i)
+                grid[i] = Point3D(cell * (i % side) + 2.5, cell * (i / side % side) - 1.5, cell * (i / side / side) + 3.0);
+            std::vector<SceneClosestPoint> closest(count);
+            Run(options, "bvh_closest_batch", count, threads, [&] {
+                ClosestPointsInScene(bvh, spread, grid, closest, INFINITY, threads);
+                sink = closest[count / 2].closest.distance;
+                return Work{ count, 0 };
+            });
+            // Clicks on points of the curves from a camera outside the lattice,
+            // with a 4 pixel tolerance at 45 degrees and 720 lines
+            const Point3D eye(-20.0, -20.0, -20.0);
+            const double tolerance = PixelsToAngle(4.0, 45.0, 720);
+            Run(options, "bvh_pick", count, threads, [&] {
+                long sum = 0;
+                for (size_t q = 0; q < queries; ++q)
+                {
+                    Point3D p = spread[q * count / queries]->getPoint(1.0);
+                    sum += PickCurve(bvh, spread, Ray3D(eye, Point3D(p.x - eye.x, p.y - eye.y, p.z - eye.z)), tolerance).curve;
+                }
+                sink = (double)sum;
+                return Work{ queries, 0 };
+            });
+        }
+
+        Run(options, "tessellate_uniform", count, threads, [&] {
+            std::vector<Vec3f> polyline;
+            uint64_t points = 0;
+            for (const auto& curve : curves)
+            {
+                TessellateCurve(*curve, UniformSegments, polyline);
+                points += polyline.size();
+            }
+            return Work{ count, points };
+        });
+
+        Run(options, "tessellate_adaptive", count, threads, [&] {
+            std::vector<Vec3f> polyline;
+            TessellationOptions tessellation;
+            uint64_t points = 0;
+            for (const auto& curve : curves)
+            {
+                TessellateCurveAdaptive(*curve, tessellation, polyline);
+                points += polyline.size();
+            }
+            return Work{ count, points };
+        });
+
+        // Task 3 output for the whole scene, written to a temporary file
+        for (OutputFormat format : { OutputFormat::Text, OutputFormat::Csv })
+        {
+            std::FILE* file = std::tmpfile();
+            if (!file)
+                break;
+            Run(options, format == OutputFormat::Text ? "task3_text" : "task3_csv", count, threads, [&] {
+                std::rewind(file);
+                OutputWriter out(file, format);
+                Task3_WritePointsAndDerivatives(curves, 0.5, out);
+                out.flush();
+                return Work{ count, 2 * count };
+            });
+            std::fclose(file);
+        }
+
+        Run(options, "task4_5_6_objects", count, threads, [&] {
+            std::vector<std::shared_ptr<Circle3D>> circles = Task4_CollectCircles(curves, threads);
+            Task5_SortByRadius(circles, threads);
+            sink = Task6_SumOfRadii(circles, threads);
+            return Work{ count, 0 };
+        });
+
+        // Task 5 alone, per circle: the comparison sort it replaced against the
+        // radix sort, both on a fresh copy, and the permutation without the copy
+        std::vector<std::shared_ptr<Circle3D>> circles = Task4_CollectCircles(curves, threads);
+        Run(options, "task5_std_sort", count, threads, [&] {
+            std::vector<std::shared_ptr<Circle3D>> sorted = circles;
+            std::sort(sorted.begin(), sorted.end(),
+                [](const std::shared_ptr<Circle3D>& a, const std::shared_ptr<Circle3D>& b) {
+                    return a->getRadius() < b->getRadius();
+                });
+            return Work{ sorted.size(), 0 };
+        });
+
+        Run(options, "task5_radix_sort", count, threads, [&] {
+            std::vector<std::shared_ptr<Circle3D>> sorted = circles;
+            Task5_SortByRadius(sorted, threads);
+            return Work{ sorted.size(), 0 };
+        });
+
+        Run(options, "task5_radix_order", count, threads, [&] {
+            std::vector<uint32_t> order = Task5_OrderByRadius(circles, threads);
+            return Work{ order.size(), 0 };
+        });
+    }
+
+    void RunCurveSetBenchmarks(const Options& options, size_t count, unsigned threads)
+    {
+        CurveSet curves;
+        Run(options, "task1_curveset", count, threads, [&] {
+            Task1_GenerateRandomCurves(curves, (int)count, options.seed, threads);
+            return Work{ count, 0 };
+        });
+        if (curves.size() != count)
+            Task1_GenerateRandomCurves(curves, (int)count, options.seed, threads);
+
+        if ((uint64_t)count * (UniformSegments + 1) * sizeof(Point3D) <= MaxTessellationBytes)
+        {
+            std::vector<Point3D> polylines;
+            Run(options, "tessellate_curveset", count, threads, [&] {
+                curves.tessellate(UniformSegments, polylines);
+                return Work{ count, polylines.size() };
+            });
+        }
+        else
+        {
+            std::fprintf(stderr, "# tessellate_curveset skipped at %zu curves: output exceeds %zu MiB\n",
+                count, MaxTessellationBytes >> 20);
+        }
+
+        Run(options, "task4_5_6_curveset", count, threads, [&] {
+            std::vector<double> radii = Task4_CollectRadii(curves);
+            Task5_SortRadii(radii, threads);
+            sink = Task6_SumOfRadii(radii, threads);
+            return Work{ count, 0 };
+        });
+
+        // Scene file round trip through a scratch file in the working directory.
+        // scene_open only maps the file; scene_load_curveset copies it into a CurveSet.
+        if (Selected(options, "scene_save") || Selected(options, "scene_open") || Selected(options, "scene_load_curveset"))
+        {
+            const std::string path = "lich_bench_scene.tmp";
+            SaveScene(path, curves);
+            Run(options, "scene_save", count, threads, [&] {
+                SaveScene(path, curves);
+                return Work{ count, 0 };
+            });
+            Run(options, "scene_open", count, threads, [&] {
+                MappedScene scene(path);
+                sink = (double)scene.size();
+                return Work{ count, 0 };
+            });
+            Run(options, "scene_load_curveset", count, threads, [&] {
+                MappedScene scene(path);
+                CurveSet loaded;
+                scene.load(loaded, threads);
+                return Work{ loaded.size(), 0 };
+            });
+            std::remove(path.c_str());
+        }
+
+        // The text formats: export, and the parallel import back into a CurveSet
+        for (SceneTextFormat format : { SceneTextFormat::Csv, SceneTextFormat::JsonLines })
+        {
+            bool csv = format == SceneTextFormat::Csv;
+            const char* exportName = csv ? "text_export_csv" : "text_export_jsonl";
+            const char* importName = csv ? "text_import_csv" : "text_import_jsonl";
+            if (!Selected(options, exportName) && !Selected(options, importName))
+                continue;
+
+            const std::string path = "lich_bench_scene.txt";
+            ExportSceneText(path, format, curves);
+            Run(options, exportName, count, threads, [&] {
+                ExportSceneText(path, format, curves);
+                return Work{ count, 0 };
+            });
+            Run(options, importName, count, threads, [&] {
+                CurveSet loaded;
+                ImportSceneText(path, format, loaded, threads);
+                return Work{ loaded.size(), 0 };
+            });
+            std::remove(path.c_str());
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    try
+    {
+        options = ParseOptions(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\nusage: lich_bench [--sizes 1000,1000000,10000000] [--format csv|json] "
+            "[--min-time seconds] [--filter substring] [--threads 1,2,4,...] [--seed n]\n", e.what());
+        return 2;
+    }
+
+    std::fprintf(stderr, "# sincos kernel: %s, hardware threads: %u\n", SinCosKernelName(), ResolveThreadCount(0));
+    PrintHeader(options);
+    for (size_t count : options.sizes)
+    {
+        for (size_t threads : options.threads)
+        {
+            RunObjectBenchmarks(options, count, (unsigned)threads);
+            RunCurveSetBenchmarks(options, count, (unsigned)threads);
+        }
+    }
+    return 0;
+}
\ No newline at end of file
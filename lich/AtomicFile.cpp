@@ -0,0 +1,49 @@
+#include "AtomicFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace
+{
+    // std::rename does not replace an existing file on Windows
+    bool MoveOver(const std::string& from, const std::string& to)
+    {
+#ifdef _WIN32
+        return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+    }
+}
+
+AtomicFile::AtomicFile(const std::string& path)
+    : target(path), temporary(path + ".tmp"), file(std::fopen(temporary.c_str(), "wb"))
+{
+    if (!file)
+        throw std::runtime_error("cannot open " + temporary + " for writing");
+}
+
+AtomicFile::~AtomicFile()
+{
+    if (file)
+    {
+        std::fclose(file);
+        std::remove(temporary.c_str());
+    }
+}
+
+void AtomicFile::commit()
+{
+    bool written = std::fflush(file) == 0;
+    written = std::fclose(file) == 0 && written;
+    file = nullptr;
+    if (!written || !MoveOver(temporary, target))
+    {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("cannot write " + target);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdio>
+#include <string>
+
+// A file written under a temporary name next to its target and moved over
+// the target only once it is complete, so a failed save leaves the previous
+// file as it was.
+class AtomicFile
+{
+public:
+    // Opens path + ".tmp" for writing; throws std::runtime_error if it cannot
+    explicit AtomicFile(const std::string& path);
+    AtomicFile(const AtomicFile&) = delete;
+    AtomicFile& operator=(const AtomicFile&) = delete;
+    // Without commit(), closes and removes the temporary file
+    ~AtomicFile();
+
+    std::FILE* get() const { return file; }
+    const std::string& path() const { return target; }
+
+    // Flushes and closes the temporary file and renames it over the target.
+    // Throws std::runtime_error on failure, after removing the temporary file.
+    void commit();
+
+private:
+    std::string target;
+    std::string temporary;
+    std::FILE* file;
+};
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "Bounds.h"
+#include <algorithm>
+#include <cmath>
+
+Point3D Aabb::center() const
+{
+    return Point3D(0.5 * (min.x + max.x), 0.5 * (min.y + max.y), 0.5 * (min.z + max.z));
+}
+
+Point3D Aabb::extents() const
+{
+    return Point3D(0.5 * (max.x - min.x), 0.5 * (max.y - min.y), 0.5 * (max.z - min.z));
+}
+
+void Aabb::expand(const Aabb& other)
+{
+    min = Point3D(std::min(min.x, other.min.x), std::min(min.y, other.min.y), std::min(min.z, other.min.z));
+    max = Point3D(std::max(max.x, other.max.x), std::max(max.y, other.max.y), std::max(max.z, other.max.z));
+}
+
+bool Aabb::overlaps(const Aabb& other) const
+{
+    return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y
+        && min.z <= other.max.z && other.min.z <= max.z;
+}
+
+double Aabb::distanceSquared(const Point3D& point) const
+{
+    double dx = std::max({ min.x - point.x, 0.0, point.x - max.x });
+    double dy = std::max({ min.y - point.y, 0.0, point.y - max.y });
+    double dz = std::max({ min.z - point.z, 0.0, point.z - max.z });
+    return dx * dx + dy * dy + dz * dz;
+}
+
+Ray3D::Ray3D(const Point3D& origin, const Point3D& direction)
+    : origin(origin), direction(direction), inverse(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z)
+{
+}
+
+bool Intersect(const Ray3D& ray, const Aabb& box, double maxT, double& entry)
+{
+    double tNear = 0.0;
+    double tFar = maxT;
+    const double origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+    const double inverse[3] = { ray.inverse.x, ray.inverse.y, ray.inverse.z };
+    const double low[3] = { box.min.x, box.min.y, box.min.z };
+    const double high[3] = { box.max.x, box.max.y, box.max.z };
+    for (int k = 0; k < 3; ++k)
+    {
+        double t0 = (low[k] - origin[k]) * inverse[k];
+        double t1 = (high[k] - origin[k]) * inverse[k];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        // A ray lying in a slab plane gives 0 * inf = NaN; the comparisons
+        // below then keep the current interval, treating the plane as inside
+        if (t0 > tNear)
+            tNear = t0;
+        if (t1 < tFar)
+            tFar = t1;
+        if (tNear > tFar)
+            return false;
+    }
+    entry = tNear;
+    return true;
+}
+
+Aabb EllipseBounds(const Transform3D& transform, double a, double b, double z)
+{
+    Point3D c = transform.applyPoint(0.0, 0.0, z);
+    double ex = std::hypot(a * transform.m[0][0], b * transform.m[0][1]);
+    double ey = std::hypot(a * transform.m[1][0], b * transform.m[1][1]);
+    double ez = std::hypot(a * transform.m[2][0], b * transform.m[2][1]);
+    return { Point3D(c.x - ex, c.y - ey, c.z - ez), Point3D(c.x + ex, c.y + ey, c.z + ez) };
+}
+
+Frustum Frustum::FromMatrix(const float m[16])
+{
+    // Gribb-Hartmann: each plane is the last row of the matrix plus or minus another row
+    auto row = [m](int r, int i) { return (double)m[i * 4 + r]; };
+
+    Frustum frustum;
+    for (int p = 0; p < 6; ++p)
+    {
+        int r = p / 2;
+        double sign = (p % 2 == 0) ? 1.0 : -1.0;
+        Plane plane = { row(3, 0) + sign * row(r, 0), row(3, 1) + sign * row(r, 1),
+            row(3, 2) + sign * row(r, 2), row(3, 3) + sign * row(r, 3) };
+
+        double length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (length > 0.0)
+            plane = { plane.x / length, plane.y / length, plane.z / length, plane.w / length };
+        frustum.planes[p] = plane;
+    }
+    return frustum;
+}
+
+bool Frustum::intersects(const Aabb& box) const
+{
+    for (const Plane& p : planes)
+    {
+        // Corner furthest along the normal; if even it is behind, the box is out
+        double x = p.x >= 0.0 ? box.max.x : box.min.x;
+        double y = p.y >= 0.0 ? box.max.y : box.min.y;
+        double z = p.z >= 0.0 ? box.max.z : box.min.z;
+        if (p.x * x + p.y * y + p.z * z + p.w < 0.0)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const
+{
+    for (const Plane& p : planes)
+    {
+        if (p.x * sphere.center.x + p.y * sphere.center.y + p.z * sphere.center.z + p.w < -sphere.radius)
+            return false;
+    }
+    return true;
+}
\ No newline at end of file
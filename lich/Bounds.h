@@ -0,0 +1,67 @@
+#pragma once
+#include "Point3D.h"
+#include "Transform3D.h"
+
+// Axis-aligned box in world space
+struct Aabb
+{
+    Point3D min;
+    Point3D max;
+
+    Point3D center() const;
+    // Half the size along each axis
+    Point3D extents() const;
+    void expand(const Aabb& other);
+    bool overlaps(const Aabb& other) const;
+    // Squared distance from point to the nearest point of the box, 0 inside
+    double distanceSquared(const Point3D& point) const;
+};
+
+// origin + t * direction for t >= 0; direction need not be unit length, t is
+// measured in multiples of it
+struct Ray3D
+{
+    Point3D origin;
+    Point3D direction;
+    // 1 / direction per axis, infinite along axes the ray does not move on
+    Point3D inverse;
+
+    Ray3D(const Point3D& origin, const Point3D& direction);
+};
+
+// Slab test: true if the ray meets box for some t in [0, maxT]; entry is the
+// first such t (0 when the origin is inside)
+bool Intersect(const Ray3D& ray, const Aabb& box, double maxT, double& entry);
+
+struct BoundingSphere
+{
+    Point3D center;
+    double radius = 0.0;
+};
+
+// Tight box of the ellipse with semi-axes a, b in the local XY plane of
+// transform, shifted by z along the local Z axis: along world axis k it
+// reaches sqrt((a * u_k)^2 + (b * v_k)^2) from the center, where u and v
+// are the transformed local X and Y axes
+Aabb EllipseBounds(const Transform3D& transform, double a, double b, double z = 0.0);
+
+// The six planes of a view volume, normals pointing inward
+class Frustum
+{
+public:
+    // From a column-major view-projection matrix with OpenGL clip space
+    // (-w <= x, y, z <= w), the layout raylib and rlgl use
+    static Frustum FromMatrix(const float m[16]);
+
+    // Conservative: may accept a box that is just outside a corner, never rejects a visible one
+    bool intersects(const Aabb& box) const;
+    bool intersects(const BoundingSphere& sphere) const;
+
+private:
+    struct Plane
+    {
+        double x, y, z, w;
+    };
+
+    Plane planes[6];
+};
\ No newline at end of file
@@ -1,56 +1,158 @@
+#define _USE_MATH_DEFINES
+
 #include "Circle.h"
+#include "SinCos.h"
+#include <algorithm>
 #include <cmath>
 
 Circle3D::Circle3D(double radius)
-    : radius(radius), position(0, 0, 0), rotation(0, 0, 0) {
+    : Curve3D(Kind), radius(radius), position(0, 0, 0), rotation(0, 0, 0) {
+    updateBounds();
+}
+
+void Circle3D::updateBounds()
+{
+    setBounds(EllipseBounds(transform, radius, radius), { position, std::fabs(radius) });
+}
+
+// The transform is rigid, so lengths are those of the local circle
+double Circle3D::length() const
+{
+    return 2.0 * M_PI * std::fabs(radius);
+}
+
+double Circle3D::arcLength(double t) const
+{
+    return std::fabs(radius) * t;
+}
+
+double Circle3D::tForArcLength(double s) const
+{
+    double total = length();
+    return total > 0.0 ? std::clamp(s, 0.0, total) / std::fabs(radius) : 0.0;
 }
 
 Point3D Circle3D::getPoint(double t) const
 {
-    double x = radius * cos(t);
-    double y = radius * sin(t);
-    double z = 0.0;
+    return transform.applyPoint(radius * cos(t), radius * sin(t), 0.0);
+}
 
-    double cosX = cos(rotation.x), sinX = sin(rotation.x);
-    double cosY = cos(rotation.y), sinY = sin(rotation.y);
-    double cosZ = cos(rotation.z), sinZ = sin(rotation.z);
+Point3D Circle3D::getDerivative(double t) const
+{
+    return transform.applyVector(-radius * sin(t), radius * cos(t), 0.0);
+}
 
-    double x1 = x * cosZ - y * sinZ;
-    double y1 = x * sinZ + y * cosZ;
-    double z1 = z;
+Point3D Circle3D::getSecondDerivative(double t) const
+{
+    return transform.applyVector(-radius * cos(t), -radius * sin(t), 0.0);
+}
 
-    double x2 = x1 * cosY + z1 * sinY;
-    double y2 = y1;
-    double z2 = -x1 * sinY + z1 * cosY;
+// Closed form: the nearest point is in the direction of p projected onto the
+// circle's plane. Every point is nearest for p on the axis; that gives t = 0.
+CurvePoint Circle3D::closestPoint(const Point3D& p) const
+{
+    Point3D local = transform.applyInverseVector(p.x - position.x, p.y - position.y, p.z - position.z);
+    double t = std::atan2(local.y, local.x);
+    if (radius < 0.0)
+        t += M_PI;
+    if (t < 0.0)
+        t += 2.0 * M_PI;
 
-    double x3 = x2;
-    double y3 = y2 * cosX - z2 * sinX;
-    double z3 = y2 * sinX + z2 * cosX;
+    CurvePoint result;
+    result.t = t;
+    result.point = getPoint(t);
+    double dx = result.point.x - p.x, dy = result.point.y - p.y, dz = result.point.z - p.z;
+    result.distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+    return result;
+}
 
-    return Point3D(x3 + position.x, y3 + position.y, z3 + position.z);
+CurveSample Circle3D::evaluate(double t, int order) const
+{
+    double c = cos(t);
+    double s = sin(t);
+    CurveSample result;
+    result.point = transform.applyPoint(radius * c, radius * s, 0.0);
+    if (order >= 1)
+        result.derivative = transform.applyVector(-radius * s, radius * c, 0.0);
+    if (order >= 2)
+        result.secondDerivative = transform.applyVector(-radius * c, -radius * s, 0.0);
+    return result;
 }
 
-Point3D Circle3D::getDerivative(double t) const
+void Circle3D::evaluate(std::span<const double> ts, std::span<CurveSample> out, int order) const
+{
+    double sines[SinCosBlock], cosines[SinCosBlock];
+
+    for (size_t first = 0; first < ts.size(); first += SinCosBlock)
+    {
+        size_t n = std::min(SinCosBlock, ts.size() - first);
+        SinCos(ts.subspan(first, n), sines, cosines);
+
+        for (size_t j = 0; j < n; ++j)
+        {
+            double c = cosines[j];
+            double s = sines[j];
+
+            CurveSample& sample = out[first + j];
+            sample.point = transform.applyPoint(radius * c, radius * s, 0.0);
+            sample.derivative = order >= 1 ? transform.applyVector(-radius * s, radius * c, 0.0) : Point3D();
+            sample.secondDerivative = order >= 2 ? transform.applyVector(-radius * c, -radius * s, 0.0) : Point3D();
+        }
+    }
+}
+
+// Every point turns the same way: the binormal is the local z axis
+FrenetFrame Circle3D::frameAt(double c, double s) const
 {
-    double dx = -radius * sin(t);
-    double dy = radius * cos(t);
-    double dz = 0.0;
+    FrenetFrame frame;
+    if (radius == 0.0)
+        return frame;
+    double sign = radius > 0.0 ? 1.0 : -1.0;
+    frame.tangent = transform.applyVector(-sign * s, sign * c, 0.0);
+    frame.normal = transform.applyVector(-sign * c, -sign * s, 0.0);
+    frame.binormal = transform.applyVector(0.0, 0.0, 1.0);
+    frame.curvature = 1.0 / std::fabs(radius);
+    return frame;
+}
 
-    double cosX = cos(rotation.x), sinX = sin(rotation.x);
-    double cosY = cos(rotation.y), sinY = sin(rotation.y);
-    double cosZ = cos(rotation.z), sinZ = sin(rotation.z);
+FrenetFrame Circle3D::frenetFrame(double t) const
+{
+    return frameAt(cos(t), sin(t));
+}
 
-    double dx1 = dx * cosZ - dy * sinZ;
-    double dy1 = dx * sinZ + dy * cosZ;
-    double dz1 = dz;
+void Circle3D::frenetFrame(std::span<const double> ts, std::span<FrenetFrame> out) const
+{
+    double sines[SinCosBlock], cosines[SinCosBlock];
+
+    for (size_t first = 0; first < ts.size(); first += SinCosBlock)
+    {
+        size_t n = std::min(SinCosBlock, ts.size() - first);
+        SinCos(ts.subspan(first, n), sines, cosines);
+        for (size_t j = 0; j < n; ++j)
+            out[first + j] = frameAt(cosines[j], sines[j]);
+    }
+}
+
+void Circle3D::sample(std::span<const double> ts, std::span<Point3D> points, std::span<Point3D> derivatives) const
+{
+    double angles[SinCosBlock], sines[SinCosBlock], cosines[SinCosBlock];
 
-    double dx2 = dx1 * cosY + dz1 * sinY;
-    double dy2 = dy1;
-    double dz2 = -dx1 * sinY + dz1 * cosY;
+    for (size_t first = 0; first < ts.size(); first += SinCosBlock)
+    {
+        size_t n = std::min(SinCosBlock, ts.size() - first);
+        for (size_t j = 0; j < n; ++j)
+            angles[j] = ts[first + j];
+        SinCos(std::span<const double>(angles, n), sines, cosines);
 
-    double dx3 = dx2;
-    double dy3 = dy2 * cosX - dz2 * sinX;
-    double dz3 = dy2 * sinX + dz2 * cosX;
+        for (size_t j = 0; j < n; ++j)
+        {
+            double c = cosines[j];
+            double s = sines[j];
 
-    return Point3D(dx3, dy3, dz3);
+            if (!points.empty())
+                points[first + j] = transform.applyPoint(radius * c, radius * s, 0.0);
+            if (!derivatives.empty())
+                derivatives[first + j] = transform.applyVector(-radius * s, radius * c, 0.0);
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,210 @@
+#define _USE_MATH_DEFINES
+
+#include "Curve3D.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    uint64_t NextCurveId()
+    {
+        static std::atomic<uint64_t> nextId{ 1 };
+        return nextId.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Samples per turn that seed closestPoint
+    const int ClosestPointSamples = 32;
+    // Newton converges quadratically from a seed; the cap only matters when
+    // it keeps falling back to bisection
+    const int MaxNewtonSteps = 40;
+
+    double DistanceSquared(const Point3D& a, const Point3D& b)
+    {
+        double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+}
+
+Curve3D::Curve3D(CurveKind kind)
+    : curveKind(kind), curveId(NextCurveId()), curveVersion(0) {
+}
+
+Curve3D::Curve3D(const Curve3D& other)
+    : curveKind(other.curveKind), curveId(NextCurveId()), curveVersion(0), box(other.box), sphere(other.sphere) {
+}
+
+Curve3D& Curve3D::operator=(const Curve3D& other)
+{
+    curveKind = other.curveKind;
+    box = other.box;
+    sphere = other.sphere;
+    touch();
+    return *this;
+}
+
+void Curve3D::setBounds(const Aabb& box, const BoundingSphere& sphere)
+{
+    this->box = box;
+    this->sphere = sphere;
+}
+
+void Curve3D::sample(std::span<const double> ts, std::span<Point3D> points, std::span<Point3D> derivatives) const
+{
+    if (!points.empty())
+    {
+        for (size_t i = 0; i < ts.size(); ++i)
+            points[i] = getPoint(ts[i]);
+    }
+    if (!derivatives.empty())
+    {
+        for (size_t i = 0; i < ts.size(); ++i)
+            derivatives[i] = getDerivative(ts[i]);
+    }
+}
+
+CurveSample Curve3D::evaluate(double t, int order) const
+{
+    CurveSample result;
+    result.point = getPoint(t);
+    if (order >= 1)
+        result.derivative = getDerivative(t);
+    if (order >= 2)
+        result.secondDerivative = getSecondDerivative(t);
+    return result;
+}
+
+void Curve3D::evaluate(std::span<const double> ts, std::span<CurveSample> out, int order) const
+{
+    for (size_t i = 0; i < ts.size(); ++i)
+        out[i] = evaluate(ts[i], order);
+}
+
+void Curve3D::frenetFrame(std::span<const double> ts, std::span<FrenetFrame> out) const
+{
+    for (size_t i = 0; i < ts.size(); ++i)
+        out[i] = frenetFrame(ts[i]);
+}
+
+void Curve3D::getArcLengthParameters(std::span<double> ts) const
+{
+    size_t n = ts.size();
+    if (n == 0)
+        return;
+    ts[0] = 0.0;
+    if (n == 1)
+        return;
+
+    double total = length();
+    for (size_t i = 1; i + 1 < n; ++i)
+    {
+        double fraction = (double)i / (n - 1);
+        ts[i] = total > 0.0 ? tForArcLength(total * fraction) : 2.0 * M_PI * fraction;
+    }
+    ts[n - 1] = 2.0 * M_PI;
+}
+
+void Curve3D::getPointsByArcLength(std::span<Point3D> points) const
+{
+    thread_local std::vector<double> ts;
+    ts.resize(points.size());
+    getArcLengthParameters(ts);
+    getPoints(ts, points);
+}
+
+CurvePoint Curve3D::closestPoint(const Point3D& p) const
+{
+    return closestPointNewton(p, 1, true);
+}
+
+CurvePoint Curve3D::closestPointNewton(const Point3D& p, int turns, bool closed) const
+{
+    int samples = ClosestPointSamples * std::max(1, turns);
+    thread_local std::vector<double> ts;
+    thread_local std::vector<Point3D> points;
+    thread_local std::vector<double> squared;
+    ts.resize(samples + 1);
+    points.resize(samples + 1);
+    squared.resize(samples + 1);
+    double h = 2.0 * M_PI / samples;
+    for (int i = 0; i <= samples; ++i)
+        ts[i] = h * i;
+    getPoints(ts, points);
+    for (int i = 0; i <= samples; ++i)
+        squared[i] = DistanceSquared(points[i], p);
+
+    double bestT = 0.0;
+    double best = INFINITY;
+    // On a closed curve the last sample repeats the first
+    int last = closed ? samples - 1 : samples;
+    for (int i = 0; i <= last; ++i)
+    {
+        double left = i > 0 ? squared[i - 1] : closed ? squared[samples - 1] : INFINITY;
+        double right = i < samples ? squared[i + 1] : INFINITY;
+        if (squared[i] > left || squared[i] > right)
+            continue;
+
+        // f(t) = |P(t) - p|^2 / 2 has f' = (P - p).P' and f'' = |P'|^2 + (P - p).P''.
+        // The minimum is within a step of the sampled one; Newton steps that
+        // leave the bracket, or come from a point where f is concave, bisect it instead.
+        double a = i > 0 || closed ? ts[i] - h : ts[i];
+        double b = i < samples ? ts[i] + h : ts[i];
+        double t = ts[i];
+        for (int k = 0; k < MaxNewtonSteps && b > a; ++k)
+        {
+            CurveSample at = evaluate(t);
+            Point3D w(at.point.x - p.x, at.point.y - p.y, at.point.z - p.z);
+            const Point3D& d1 = at.derivative;
+            const Point3D& d2 = at.secondDerivative;
+            double slope = w.x * d1.x + w.y * d1.y + w.z * d1.z;
+            double curvature = d1.x * d1.x + d1.y * d1.y + d1.z * d1.z + w.x * d2.x + w.y * d2.y + w.z * d2.z;
+            if (slope > 0.0)
+                b = t;
+            else if (slope < 0.0)
+                a = t;
+            else
+                break;
+
+            double next = curvature > 0.0 ? t - slope / curvature : NAN;
+            if (!(next > a && next < b))
+                next = 0.5 * (a + b);
+            bool converged = std::fabs(next - t) <= 4.0 * DBL_EPSILON * std::max(1.0, std::fabs(t));
+            t = next;
+            if (converged)
+                break;
+        }
+
+        double refined = DistanceSquared(getPoint(t), p);
+        if (squared[i] <= refined)
+        {
+            refined = squared[i];
+            t = ts[i];
+        }
+        if (refined < best)
+        {
+            best = refined;
+            bestT = t;
+        }
+    }
+
+    if (closed && bestT < 0.0)
+        bestT += 2.0 * M_PI;
+    CurvePoint result;
+    result.t = bestT;
+    result.point = getPoint(bestT);
+    result.distance = std::sqrt(DistanceSquared(result.point, p));
+    return result;
+}
+
+const char* CurveKindName(CurveKind kind)
+{
+    switch (kind)
+    {
+    case CurveKind::Circle: return "Circle";
+    case CurveKind::Ellipse: return "Ellipse";
+    case CurveKind::Helix: return "Helix";
+    }
+    return "Unknown";
+}
\ No newline at end of file
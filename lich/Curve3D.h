@@ -1,17 +1,127 @@
 #pragma once
 #include "Point3D.h"
+#include "Bounds.h"
+#include <span>
+#include <cstdint>
+
+enum class CurveKind : uint8_t
+{
+    Circle,
+    Ellipse,
+    Helix
+};
+
+// Point and derivatives at one t, from Curve3D::evaluate
+struct CurveSample
+{
+    Point3D point;
+    Point3D derivative;       // dP/dt, if order >= 1
+    Point3D secondDerivative; // d2P/dt2, if order >= 2
+};
+
+// Unit tangent, principal normal and binormal at one t, with the curvature
+// and torsion there. Where the curve is straight or stops (zero radius or
+// axes) the normal and binormal are zero, and so are curvature and torsion.
+struct FrenetFrame
+{
+    Point3D tangent;
+    Point3D normal;
+    Point3D binormal;
+    double curvature = 0.0;
+    double torsion = 0.0;
+};
+
+// Result of Curve3D::closestPoint
+struct CurvePoint
+{
+    double t = 0.0;
+    Point3D point;
+    double distance = 0.0;
+};
 
 class Curve3D
 {
 public:
     virtual ~Curve3D() = default;
 
+    // Concrete type of the curve; a byte compare instead of an RTTI cast (see CurveVisit.h)
+    CurveKind kind() const { return curveKind; }
+
+    // Unique for the lifetime of the program, unlike the object address
+    uint64_t id() const { return curveId; }
+    // Bumped by every setter that changes the geometry, so caches know when to resample
+    uint64_t version() const { return curveVersion; }
+
     virtual Point3D getPoint(double t) const = 0;
     virtual Point3D getDerivative(double t) const = 0;
+    virtual Point3D getSecondDerivative(double t) const = 0;
+
+    // The point and its first `order` derivatives (up to 2) from one sin/cos
+    // and one transform; derivatives beyond order are left at zero. The
+    // defaults call the getters above, the curves override them.
+    virtual CurveSample evaluate(double t, int order = 2) const;
+    // Batched: out[i] for ts[i]; out must hold ts.size() elements
+    virtual void evaluate(std::span<const double> ts, std::span<CurveSample> out, int order = 2) const;
+
+    // Closed-form Frenet frame; the batched overload fills out[i] for ts[i]
+    virtual FrenetFrame frenetFrame(double t) const = 0;
+    virtual void frenetFrame(std::span<const double> ts, std::span<FrenetFrame> out) const;
+
+    // Batch evaluation: fills points[i] and/or derivatives[i] for every ts[i].
+    // An empty output span is skipped, a non-empty one must hold ts.size() elements.
+    virtual void sample(std::span<const double> ts, std::span<Point3D> points, std::span<Point3D> derivatives) const;
+    void getPoints(std::span<const double> ts, std::span<Point3D> points) const { sample(ts, points, {}); }
+    void getDerivatives(std::span<const double> ts, std::span<Point3D> derivatives) const { sample(ts, {}, derivatives); }
+
+    // Arc length over t in [0, 2pi], the range every curve is drawn over
+    virtual double length() const = 0;
+    // Arc length from t = 0 to t
+    virtual double arcLength(double t) const = 0;
+    // Inverse of arcLength: the t that lies s along the curve from t = 0.
+    // s is clamped to [0, length()]; a curve of zero length returns 0.
+    virtual double tForArcLength(double s) const = 0;
+    // ts.size() parameters at equal arc-length steps from t = 0 to 2pi, ends
+    // included. A curve of zero length gets equal steps in t instead.
+    virtual void getArcLengthParameters(std::span<double> ts) const;
+    // Points at equal distances along the curve, both ends included
+    void getPointsByArcLength(std::span<Point3D> points) const;
+
+    // The point of the curve nearest to p, t in [0, 2pi]. The default seeds
+    // Newton iteration on the derivative of the squared distance with the
+    // local minima of a coarse sample.
+    virtual CurvePoint closestPoint(const Point3D& p) const;
 
     virtual void setPosition(const Point3D& pos) = 0;
 
     virtual void setRotation(const Point3D& rot) = 0;
 
     virtual Point3D getRotation() const = 0;
-};
\ No newline at end of file
+
+    // World-space bounds, recomputed analytically by every setter that moves
+    // or reshapes the curve, so reading them costs nothing
+    const Aabb& bounds() const { return box; }
+    const BoundingSphere& boundingSphere() const { return sphere; }
+
+protected:
+    explicit Curve3D(CurveKind kind);
+    // A copy is a different curve as far as caches are concerned
+    Curve3D(const Curve3D& other);
+    Curve3D& operator=(const Curve3D& other);
+
+    // closestPoint seeded from a fixed number of samples per turn, for a
+    // curve that winds `turns` times over [0, 2pi]. A closed curve is also
+    // searched across t = 0, an open one up to its ends.
+    CurvePoint closestPointNewton(const Point3D& p, int turns, bool closed) const;
+
+    void touch() { ++curveVersion; }
+    void setBounds(const Aabb& box, const BoundingSphere& sphere);
+
+private:
+    CurveKind curveKind;
+    uint64_t curveId;
+    uint64_t curveVersion;
+    Aabb box;
+    BoundingSphere sphere;
+};
+
+const char* CurveKindName(CurveKind kind);
\ No newline at end of file
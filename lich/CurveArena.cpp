@@ -0,0 +1,202 @@
+#include "CurveArena.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+
+namespace
+{
+    // Blocks per chunk: about a megabyte of curves per malloc
+    const size_t BlocksPerChunk = 4096;
+    // Anything bigger than a curve with its control block goes to operator new
+    const size_t MaxBlockSize = 1024;
+
+    struct Pool
+    {
+        size_t size;
+        size_t alignment;
+        size_t blockSize;
+        std::vector<std::unique_ptr<std::byte[]>> chunks;
+        size_t chunk = 0; // chunk the bump pointer is in
+        size_t next = 0;  // next unused block in that chunk
+        void* freeList = nullptr;
+        size_t live = 0;
+
+        Pool(size_t size, size_t align)
+            : size(size), alignment(align), blockSize((std::max(size, sizeof(void*)) + align - 1) / align * align) {
+        }
+
+        std::byte* chunkBase(size_t i) const
+        {
+            // Chunks are over-allocated by one alignment so the first block can be aligned
+            uintptr_t raw = reinterpret_cast<uintptr_t>(chunks[i].get());
+            return reinterpret_cast<std::byte*>((raw + alignment - 1) / alignment * alignment);
+        }
+
+        void* allocate()
+        {
+            ++live;
+            if (freeList)
+            {
+                void* p = freeList;
+                freeList = *static_cast<void**>(p);
+                return p;
+            }
+            if (chunk < chunks.size() && next == BlocksPerChunk)
+            {
+                ++chunk;
+                next = 0;
+            }
+            if (chunk == chunks.size())
+                chunks.emplace_back(new std::byte[blockSize * BlocksPerChunk + alignment]);
+            return chunkBase(chunk) + blockSize * next++;
+        }
+
+        void deallocate(void* p)
+        {
+            --live;
+            if (live == 0)
+            {
+                // Everything is free: start over at the first chunk instead of
+                // following a free list scattered across all of them
+                freeList = nullptr;
+                chunk = 0;
+                next = 0;
+                return;
+            }
+            *static_cast<void**>(p) = freeList;
+            freeList = p;
+        }
+    };
+}
+
+// A set of pools behind one lock. The lock is only contended when another
+// thread frees blocks while the heap's owner is allocating from it.
+struct CurveArena::Heap
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Pool>> pools;
+
+    Pool& poolFor(size_t size, size_t alignment)
+    {
+        for (auto& pool : pools)
+        {
+            if (pool->size == size && pool->alignment == alignment)
+                return *pool;
+        }
+        pools.push_back(std::make_unique<Pool>(size, alignment));
+        return *pools.back();
+    }
+};
+
+CurveArena::Local::Local(CurveArena& arena) : arena(arena)
+{
+    std::lock_guard<std::mutex> lock(arena.mutex);
+    if (arena.idle.empty())
+    {
+        arena.heaps.push_back(std::make_unique<Heap>());
+        heap = arena.heaps.back().get();
+    }
+    else
+    {
+        heap = arena.idle.back();
+        arena.idle.pop_back();
+    }
+}
+
+CurveArena::Local::~Local()
+{
+    std::lock_guard<std::mutex> lock(arena.mutex);
+    arena.idle.push_back(heap);
+}
+
+CurveArena::CurveArena()
+{
+    heaps.push_back(std::make_unique<Heap>());
+}
+
+CurveArena::~CurveArena()
+{
+    assert(liveBlocks() == 0 && "curves must be destroyed before their arena");
+}
+
+void* CurveArena::allocate(Heap& heap, size_t size, size_t alignment)
+{
+    if (size > MaxBlockSize)
+        return ::operator new(size, std::align_val_t(alignment));
+
+    std::lock_guard<std::mutex> lock(heap.mutex);
+    return heap.poolFor(size, alignment).allocate();
+}
+
+void CurveArena::deallocate(Heap& heap, void* p, size_t size, size_t alignment)
+{
+    if (size > MaxBlockSize)
+    {
+        ::operator delete(p, std::align_val_t(alignment));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(heap.mutex);
+    heap.poolFor(size, alignment).deallocate(p);
+}
+
+size_t CurveArena::liveBlocks() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t live = 0;
+    for (const auto& heap : heaps)
+    {
+        std::lock_guard<std::mutex> heapLock(heap->mutex);
+        for (const auto& pool : heap->pools)
+            live += pool->live;
+    }
+    return live;
+}
+
+size_t CurveArena::reservedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t bytes = 0;
+    for (const auto& heap : heaps)
+    {
+        std::lock_guard<std::mutex> heapLock(heap->mutex);
+        for (const auto& pool : heap->pools)
+            bytes += pool->chunks.size() * (pool->blockSize * BlocksPerChunk + pool->alignment);
+    }
+    return bytes;
+}
+
+void CurveArena::reset()
+{
+    clear(false);
+}
+
+void CurveArena::release()
+{
+    clear(true);
+}
+
+void CurveArena::clear(bool freeChunks)
+{
+    if (liveBlocks() != 0)
+        throw std::logic_error("CurveArena: curves are still alive");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& heap : heaps)
+    {
+        std::lock_guard<std::mutex> heapLock(heap->mutex);
+        if (freeChunks)
+        {
+            heap->pools.clear();
+            continue;
+        }
+        for (auto& pool : heap->pools)
+        {
+            pool->freeList = nullptr;
+            pool->chunk = 0;
+            pool->next = 0;
+        }
+    }
+}
\ No newline at end of file
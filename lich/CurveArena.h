@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Memory for the curves of one scene. Objects are carved out of large chunks
+// by a pool per block size, which in practice is one pool per curve type, so
+// curves of a type sit next to each other and freed blocks are recycled
+// without going back to malloc. When a pool has no live blocks left its
+// chunks are reused from the start, so clearing a scene and building the
+// next one costs no allocations and keeps the new curves contiguous.
+//
+// The pools live in heaps, each with its own lock. make() uses a heap shared
+// by all callers; a Local takes a heap for itself, so threads filling a
+// scene in parallel do not wait on each other. Blocks always go back to the
+// heap they came from, whichever thread frees them.
+//
+// Curves made here must be destroyed before the arena. The arena is safe to
+// use from several threads, except for reset() and release().
+class CurveArena
+{
+public:
+    struct Heap;
+
+    // A heap for the exclusive use of one thread, e.g. one per ParallelFor
+    // range; handed back to the arena for reuse when destroyed
+    class Local
+    {
+    public:
+        explicit Local(CurveArena& arena);
+        Local(const Local&) = delete;
+        Local& operator=(const Local&) = delete;
+        ~Local();
+
+        template <class T, class... Args>
+        std::shared_ptr<T> make(Args&&... args);
+
+    private:
+        CurveArena& arena;
+        Heap* heap;
+    };
+
+    CurveArena();
+    CurveArena(const CurveArena&) = delete;
+    CurveArena& operator=(const CurveArena&) = delete;
+    ~CurveArena();
+
+    // std::make_shared with the object and its control block in one pool block
+    template <class T, class... Args>
+    std::shared_ptr<T> make(Args&&... args);
+
+    static void* allocate(Heap& heap, size_t size, size_t alignment);
+    static void deallocate(Heap& heap, void* p, size_t size, size_t alignment);
+
+    size_t liveBlocks() const;
+    size_t reservedBytes() const;
+    // Bulk release: every pool starts over at its first chunk, or with
+    // release() also returns its chunks to the system. All curves made here
+    // must be gone (std::logic_error otherwise), and nothing may allocate
+    // from the arena meanwhile.
+    void reset();
+    void release();
+
+private:
+    mutable std::mutex mutex;
+    // heaps[0] is the shared one; the others are lent to Locals
+    std::vector<std::unique_ptr<Heap>> heaps;
+    std::vector<Heap*> idle;
+
+    Heap& shared() { return *heaps[0]; }
+    void clear(bool freeChunks);
+};
+
+// Standard allocator over a CurveArena heap, for std::allocate_shared
+template <class T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(CurveArena::Heap& heap) : heap(&heap) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : heap(other.heap) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(CurveArena::allocate(*heap, n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, size_t n) { CurveArena::deallocate(*heap, p, n * sizeof(T), alignof(T)); }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return heap == other.heap; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return heap != other.heap; }
+
+private:
+    template <class U>
+    friend class ArenaAllocator;
+
+    CurveArena::Heap* heap;
+};
+
+template <class T, class... Args>
+std::shared_ptr<T> CurveArena::make(Args&&... args)
+{
+    return std::allocate_shared<T>(ArenaAllocator<T>(shared()), std::forward<Args>(args)...);
+}
+
+template <class T, class... Args>
+std::shared_ptr<T> CurveArena::Local::make(Args&&... args)
+{
+    return std::allocate_shared<T>(ArenaAllocator<T>(*heap), std::forward<Args>(args)...);
+}
\ No newline at end of file
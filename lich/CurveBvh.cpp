@@ -0,0 +1,463 @@
+#include "CurveBvh.h"
+#include "Parallel.h"
+#include "RadixSort.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    // Leaves never hold more; the SAH decides whether to stop earlier
+    const uint32_t MaxLeafItems = 4;
+    const int Bins = 16;
+    // Subtrees smaller than this are not worth a thread of their own
+    const size_t MinParallelItems = 4096;
+
+    // Aabb with indexable axes, so the split code can loop over them
+    struct Box
+    {
+        double low[3] = { INFINITY, INFINITY, INFINITY };
+        double high[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+        void grow(const Box& other)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                low[k] = std::min(low[k], other.low[k]);
+                high[k] = std::max(high[k], other.high[k]);
+            }
+        }
+
+        // Half the surface area: the SAH only compares ratios
+        double halfArea() const
+        {
+            double dx = high[0] - low[0], dy = high[1] - low[1], dz = high[2] - low[2];
+            return dx * dy + dy * dz + dz * dx;
+        }
+
+        Aabb aabb() const { return { Point3D(low[0], low[1], low[2]), Point3D(high[0], high[1], high[2]) }; }
+    };
+
+    Aabb EmptyBox()
+    {
+        return Box().aabb();
+    }
+
+    bool SameBox(const Aabb& a, const Aabb& b)
+    {
+        return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z
+            && a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+    }
+
+    double DistanceSquared(const Point3D& a, const Point3D& b)
+    {
+        double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+}
+
+// An item's box, partitioned in place while building so the splits read
+// memory in order instead of chasing indices
+struct CurveBvh::BuildItem
+{
+    Box box;
+    uint32_t item;
+
+    // Twice the centroid, which orders and bins the same
+    double centroid(int axis) const { return box.low[axis] + box.high[axis]; }
+};
+
+// A range left for a worker by the serial top levels, built into its own node list
+struct CurveBvh::Subtree
+{
+    uint32_t node;
+    uint32_t begin;
+    uint32_t end;
+    std::vector<Node> nodes;
+};
+
+void CurveBvh::clear()
+{
+    nodes.clear();
+    items.clear();
+    itemBoxes.clear();
+    parents.clear();
+    leafOf.clear();
+}
+
+void CurveBvh::build(std::span<const Aabb> boxes, unsigned threads)
+{
+    if (boxes.size() >= None)
+        throw std::length_error("too many items for CurveBvh");
+
+    clear();
+    itemBoxes.assign(boxes.begin(), boxes.end());
+    size_t n = boxes.size();
+    if (n == 0)
+        return;
+
+    std::vector<BuildItem> work(n);
+    ParallelFor(n, threads, ParallelChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Aabb& b = boxes[i];
+            work[i] = { { { b.min.x, b.min.y, b.min.z }, { b.max.x, b.max.y, b.max.z } }, (uint32_t)i };
+        }
+    });
+
+    // The top levels are split on this thread until the ranges are small
+    // enough to give every worker several, then those are built in parallel
+    unsigned workers = ResolveThreadCount(threads);
+    size_t splitLimit = std::max<size_t>(n / (4 * (size_t)workers), MinParallelItems);
+    std::vector<Subtree> deferred;
+    nodes.reserve(2 * n / MaxLeafItems + 1);
+    nodes.push_back({});
+    buildNode(nodes, 0, work, 0, (uint32_t)n, splitLimit, &deferred);
+
+    ParallelFor(deferred.size(), threads, 1, [&](size_t first, size_t last) {
+        for (size_t s = first; s < last; ++s)
+        {
+            Subtree& subtree = deferred[s];
+            subtree.nodes.reserve(2 * (subtree.end - subtree.begin) / MaxLeafItems + 1);
+            subtree.nodes.push_back({});
+            buildNode(subtree.nodes, 0, work, subtree.begin, subtree.end, n, nullptr);
+        }
+    });
+
+    // Splice each subtree in: its root replaces the placeholder node, the rest
+    // are appended, so children still always follow their parent
+    for (const Subtree& subtree : deferred)
+    {
+        uint32_t offset = (uint32_t)nodes.size() - 1;
+        for (size_t i = 0; i < subtree.nodes.size(); ++i)
+        {
+            Node node = subtree.nodes[i];
+            if (node.count == 0)
+                node.first += offset;
+            if (i == 0)
+                nodes[subtree.node] = node;
+            else
+                nodes.push_back(node);
+        }
+    }
+
+    items.resize(n);
+    for (size_t i = 0; i < n; ++i)
+        items[i] = work[i].item;
+    link();
+}
+
+void CurveBvh::build(const std::vector<std::shared_ptr<Curve3D>>& curves, unsigned threads)
+{
+    std::vector<Aabb> boxes(curves.size());
+    ParallelFor(curves.size(), threads, ParallelChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            boxes[i] = curves[i]->bounds();
+    });
+    build(boxes, threads);
+}
+
+void CurveBvh::buildNode(std::vector<Node>& out, uint32_t node, std::vector<BuildItem>& work, uint32_t begin,
+    uint32_t end, size_t splitLimit, std::vector<Subtree>* deferred)
+{
+    Box box, centroids;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        box.grow(work[i].box);
+        for (int k = 0; k < 3; ++k)
+        {
+            centroids.low[k] = std::min(centroids.low[k], work[i].centroid(k));
+            centroids.high[k] = std::max(centroids.high[k], work[i].centroid(k));
+        }
+    }
+    out[node] = { box.aabb(), begin, end - begin };
+
+    uint32_t count = end - begin;
+    if (count <= MaxLeafItems)
+        return;
+    if (deferred && count <= splitLimit)
+    {
+        deferred->push_back({ node, begin, end, {} });
+        return;
+    }
+
+    struct Bin
+    {
+        Box box;
+        uint32_t count = 0;
+    };
+
+    // Binned SAH along the axis the centroids spread furthest on: they are
+    // dropped into equal slices of their range, and the split between slices
+    // with the lowest area * count summed over both sides wins
+    int axis = 0;
+    for (int k = 1; k < 3; ++k)
+    {
+        if (centroids.high[k] - centroids.low[k] > centroids.high[axis] - centroids.low[axis])
+            axis = k;
+    }
+    double low = centroids.low[axis];
+    double extent = centroids.high[axis] - low;
+    double scale = extent > 0.0 ? Bins / extent : 0.0;
+    auto binOf = [&](const BuildItem& w) { return std::min((int)((w.centroid(axis) - low) * scale), Bins - 1); };
+
+    int bestSplit = 0;
+    if (extent > 0.0)
+    {
+        Bin bins[Bins];
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            Bin& bin = bins[binOf(work[i])];
+            bin.box.grow(work[i].box);
+            ++bin.count;
+        }
+
+        // rightCost[k]: cost of bins k.. on the right side of a split before bin k
+        double rightCost[Bins];
+        Box right;
+        uint32_t inRight = 0;
+        for (int k = Bins - 1; k > 0; --k)
+        {
+            right.grow(bins[k].box);
+            inRight += bins[k].count;
+            rightCost[k] = inRight > 0 ? right.halfArea() * inRight : INFINITY;
+        }
+
+        // The lowest and highest centroids land in the first and last bin, so
+        // some split leaves items on both sides
+        double bestCost = INFINITY;
+        Box left;
+        uint32_t inLeft = 0;
+        for (int k = 1; k < Bins; ++k)
+        {
+            left.grow(bins[k - 1].box);
+            inLeft += bins[k - 1].count;
+            if (inLeft == 0)
+                continue;
+            double cost = left.halfArea() * inLeft + rightCost[k];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = k;
+            }
+        }
+    }
+
+    uint32_t middle;
+    if (bestSplit > 0)
+    {
+        middle = (uint32_t)(std::partition(work.begin() + begin, work.begin() + end, [&](const BuildItem& w) {
+            return binOf(w) < bestSplit;
+        }) - work.begin());
+    }
+    else
+    {
+        // All centroids coincide; any halving is as good as another
+        middle = begin + count / 2;
+    }
+
+    uint32_t left = (uint32_t)out.size();
+    out.push_back({});
+    out.push_back({});
+    out[node].first = left;
+    out[node].count = 0;
+    buildNode(out, left, work, begin, middle, splitLimit, deferred);
+    buildNode(out, left + 1, work, middle, end, splitLimit, deferred);
+}
+
+void CurveBvh::link()
+{
+    parents.assign(nodes.size(), None);
+    leafOf.assign(itemBoxes.size(), None);
+    for (uint32_t i = 0; i < nodes.size(); ++i)
+    {
+        const Node& node = nodes[i];
+        if (node.count == 0)
+        {
+            parents[node.first] = i;
+            parents[node.first + 1] = i;
+        }
+        else
+        {
+            for (uint32_t k = node.first; k < node.first + node.count; ++k)
+                leafOf[items[k]] = i;
+        }
+    }
+}
+
+void CurveBvh::refit(uint32_t item, const Aabb& box)
+{
+    if (item >= itemBoxes.size())
+        throw std::out_of_range("CurveBvh::refit: item out of range");
+
+    itemBoxes[item] = box;
+    uint32_t node = leafOf[item];
+    Aabb leafBox = EmptyBox();
+    for (uint32_t k = nodes[node].first; k < nodes[node].first + nodes[node].count; ++k)
+        leafBox.expand(itemBoxes[items[k]]);
+    nodes[node].box = leafBox;
+
+    // Ancestors above the first one whose box comes out the same are unaffected
+    for (uint32_t p = parents[node]; p != None; p = parents[p])
+    {
+        Aabb parentBox = nodes[nodes[p].first].box;
+        parentBox.expand(nodes[nodes[p].first + 1].box);
+        if (SameBox(parentBox, nodes[p].box))
+            break;
+        nodes[p].box = parentBox;
+    }
+}
+
+void CurveBvh::query(const Aabb& region, std::vector<uint32_t>& out) const
+{
+    if (nodes.empty() || !nodes[0].box.overlaps(region))
+        return;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (itemBoxes[items[i]].overlaps(region))
+                    out.push_back(items[i]);
+            }
+            continue;
+        }
+        for (uint32_t child = node.first; child < node.first + 2; ++child)
+        {
+            if (nodes[child].box.overlaps(region))
+                stack.push_back(child);
+        }
+    }
+}
+
+void CurveBvh::query(const Ray3D& ray, double maxT, std::vector<uint32_t>& out) const
+{
+    double t;
+    if (nodes.empty() || !Intersect(ray, nodes[0].box, maxT, t))
+        return;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (Intersect(ray, itemBoxes[items[i]], maxT, t))
+                    out.push_back(items[i]);
+            }
+            continue;
+        }
+        for (uint32_t child = node.first; child < node.first + 2; ++child)
+        {
+            if (Intersect(ray, nodes[child].box, maxT, t))
+                stack.push_back(child);
+        }
+    }
+}
+
+namespace
+{
+    // With a hint, the hinted curve sets the starting bound and is the answer
+    // unless the search finds a closer one
+    SceneClosestPoint Closest(const CurveBvh& bvh, const std::vector<std::shared_ptr<Curve3D>>& curves,
+        const Point3D& point, double maxDistance, long hint)
+    {
+        SceneClosestPoint result;
+        double limit = maxDistance;
+        if (hint >= 0)
+        {
+            CurvePoint closest = curves[hint]->closestPoint(point);
+            if (closest.distance < limit)
+            {
+                result.curve = hint;
+                result.closest = closest;
+                limit = closest.distance;
+            }
+        }
+
+        double best = limit;
+        uint32_t item = bvh.search([&](const Aabb& box) { return std::sqrt(box.distanceSquared(point)); },
+            [&](uint32_t i) {
+                // The sphere is tighter than the box for circles and ellipses
+                const BoundingSphere& sphere = curves[i]->boundingSphere();
+                double bound = std::sqrt(DistanceSquared(sphere.center, point)) - sphere.radius;
+                if (bound >= best || (long)i == hint)
+                    return std::max(bound, best);
+                CurvePoint closest = curves[i]->closestPoint(point);
+                // search() keeps exactly the items that beat the best so far
+                if (closest.distance < best)
+                {
+                    best = closest.distance;
+                    result.closest = closest;
+                }
+                return closest.distance;
+            },
+            limit);
+        if (item != CurveBvh::None)
+            result.curve = (long)item;
+        return result;
+    }
+
+    // 17 bits of each coordinate interleaved: 51 bits, exact in a double
+    double MortonKey(const Point3D& p, const Aabb& box)
+    {
+        auto quantize = [](double v, double low, double high) {
+            double scaled = high > low ? (v - low) / (high - low) * 131071.0 : 0.0;
+            return (uint64_t)std::clamp(scaled, 0.0, 131071.0);
+        };
+        auto spread = [](uint64_t v) {
+            uint64_t r = 0;
+            for (int bit = 0; bit < 17; ++bit)
+                r |= ((v >> bit) & 1) << (3 * bit);
+            return r;
+        };
+        uint64_t x = quantize(p.x, box.min.x, box.max.x);
+        uint64_t y = quantize(p.y, box.min.y, box.max.y);
+        uint64_t z = quantize(p.z, box.min.z, box.max.z);
+        return (double)(spread(x) | spread(y) << 1 | spread(z) << 2);
+    }
+}
+
+SceneClosestPoint ClosestPointInScene(const CurveBvh& bvh, const std::vector<std::shared_ptr<Curve3D>>& curves,
+    const Point3D& point, double maxDistance)
+{
+    return Closest(bvh, curves, point, maxDistance, -1);
+}
+
+void ClosestPointsInScene(const CurveBvh& bvh, const std::vector<std::shared_ptr<Curve3D>>& curves,
+    std::span<const Point3D> queries, std::span<SceneClosestPoint> results, double maxDistance, unsigned threads)
+{
+    if (results.size() != queries.size())
+        throw std::invalid_argument("ClosestPointsInScene: results and queries differ in size");
+
+    Aabb box = EmptyBox();
+    for (const Point3D& q : queries)
+        box.expand({ q, q });
+    std::vector<double> keys(queries.size());
+    ParallelFor(queries.size(), threads, ParallelChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            keys[i] = MortonKey(queries[i], box);
+    });
+    std::vector<uint32_t> order = RadixSortOrder(keys, threads);
+
+    ParallelFor(order.size(), threads, ParallelChunk, [&](size_t begin, size_t end) {
+        long hint = -1;
+        for (size_t k = begin; k < end; ++k)
+        {
+            uint32_t i = order[k];
+            results[i] = Closest(bvh, curves, queries[i], maxDistance, hint);
+            hint = results[i].curve;
+        }
+    });
+}
\ No newline at end of file
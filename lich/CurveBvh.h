@@ -0,0 +1,222 @@
+#pragma once
+#include "Bounds.h"
+#include "Curve3D.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Bounding-volume hierarchy over the world boxes of a list of curves, for
+// picking and region queries. Items are indices into the list it was built
+// from. Built top-down with binned SAH splits, the largest subtrees in
+// parallel; a curve that moves or changes shape is refitted in O(depth)
+// without touching the rest of the tree. Adding or removing curves shifts
+// the indices, so the tree has to be rebuilt.
+class CurveBvh
+{
+public:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    // threads: 0 = all hardware threads
+    void build(std::span<const Aabb> boxes, unsigned threads = 0);
+    void build(const std::vector<std::shared_ptr<Curve3D>>& curves, unsigned threads = 0);
+    void clear();
+
+    size_t size() const { return itemBoxes.size(); }
+    bool empty() const { return itemBoxes.empty(); }
+    // Union of all boxes; undefined when empty
+    const Aabb& bounds() const { return nodes.front().box; }
+
+    // New box for one item; the boxes of its ancestors are recomputed
+    void refit(uint32_t item, const Aabb& box);
+
+    // Items whose boxes overlap region, appended to out in no particular order
+    void query(const Aabb& region, std::vector<uint32_t>& out) const;
+    // Items whose boxes the ray enters within [0, maxT], appended to out
+    void query(const Ray3D& ray, double maxT, std::vector<uint32_t>& out) const;
+
+    // Front-to-back traversal for ray picking. hit(item, maxT) is called for
+    // every item whose box the ray enters before maxT, nearer boxes first;
+    // it tests the item itself and lowers maxT to the hit distance if it is
+    // closer, which prunes everything behind. Returns the final maxT.
+    template <class Hit>
+    double raycast(const Ray3D& ray, double maxT, Hit&& hit) const;
+
+    // Branch and bound: distance(item) is the exact distance from point to
+    // the item. Returns the item with the smallest distance, or None when
+    // empty; boxes farther away than the best distance so far are skipped.
+    template <class Distance>
+    uint32_t nearest(const Point3D& point, Distance&& distance, double* nearestDistance = nullptr) const;
+
+    // The same search under any measure: metric(item) is exact and
+    // bound(const Aabb&) never exceeds it for an item inside the box. Returns
+    // the item with the smallest metric below limit, or None.
+    template <class Bound, class Metric>
+    uint32_t search(Bound&& bound, Metric&& metric, double limit = INFINITY, double* best = nullptr) const;
+
+private:
+    // A leaf holds items[first, first + count); an inner node (count == 0)
+    // has its children at first and first + 1
+    struct Node
+    {
+        Aabb box;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    struct BuildItem;
+    struct Subtree;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> items;
+    std::vector<Aabb> itemBoxes;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> leafOf;
+
+    static void buildNode(std::vector<Node>& out, uint32_t node, std::vector<BuildItem>& work, uint32_t begin,
+        uint32_t end, size_t splitLimit, std::vector<Subtree>* deferred);
+    void link();
+};
+
+// The curve of a scene nearest to a query point
+struct SceneClosestPoint
+{
+    long curve = -1; // index into the curve list, -1 if none is within range
+    CurvePoint closest;
+};
+
+// Nearest curve by Curve3D::closestPoint, searched through bvh, which must
+// have been built from curves. Curves further than maxDistance are ignored.
+SceneClosestPoint ClosestPointInScene(const CurveBvh& bvh, const std::vector<std::shared_ptr<Curve3D>>& curves,
+    const Point3D& point, double maxDistance = INFINITY);
+
+// results[i] for queries[i], on `threads` threads (0 = all). The queries are
+// visited in Morton order, and each starts from the answer of the one before
+// as a bound, so dense query sets mostly confirm a known curve.
+void ClosestPointsInScene(const CurveBvh& bvh, const std::vector<std::shared_ptr<Curve3D>>& curves,
+    std::span<const Point3D> queries, std::span<SceneClosestPoint> results, double maxDistance = INFINITY,
+    unsigned threads = 0);
+
+template <class Hit>
+double CurveBvh::raycast(const Ray3D& ray, double maxT, Hit&& hit) const
+{
+    struct Entry
+    {
+        uint32_t node;
+        double t;
+    };
+
+    double t;
+    if (nodes.empty() || !Intersect(ray, nodes[0].box, maxT, t))
+        return maxT;
+
+    std::vector<Entry> stack;
+    stack.reserve(64);
+    stack.push_back({ 0, t });
+    while (!stack.empty())
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+        // maxT may have dropped since the box was pushed
+        if (entry.t > maxT)
+            continue;
+
+        const Node& node = nodes[entry.node];
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (Intersect(ray, itemBoxes[items[i]], maxT, t))
+                    hit(items[i], maxT);
+            }
+            continue;
+        }
+
+        double t0, t1;
+        bool hit0 = Intersect(ray, nodes[node.first].box, maxT, t0);
+        bool hit1 = Intersect(ray, nodes[node.first + 1].box, maxT, t1);
+        // The nearer child goes on top so it is visited first
+        if (hit0 && hit1 && t0 < t1)
+        {
+            stack.push_back({ node.first + 1, t1 });
+            stack.push_back({ node.first, t0 });
+        }
+        else
+        {
+            if (hit0)
+                stack.push_back({ node.first, t0 });
+            if (hit1)
+                stack.push_back({ node.first + 1, t1 });
+        }
+    }
+    return maxT;
+}
+
+template <class Distance>
+uint32_t CurveBvh::nearest(const Point3D& point, Distance&& distance, double* nearestDistance) const
+{
+    return search([&](const Aabb& box) { return std::sqrt(box.distanceSquared(point)); }, distance, INFINITY,
+        nearestDistance);
+}
+
+template <class Bound, class Metric>
+uint32_t CurveBvh::search(Bound&& bound, Metric&& metric, double limit, double* best) const
+{
+    struct Entry
+    {
+        uint32_t node;
+        double bound;
+    };
+
+    uint32_t found = None;
+    double smallest = limit;
+    std::vector<Entry> stack;
+    if (!nodes.empty())
+    {
+        stack.reserve(64);
+        stack.push_back({ 0, bound(nodes[0].box) });
+    }
+    while (!stack.empty())
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+        if (entry.bound >= smallest)
+            continue;
+
+        const Node& node = nodes[entry.node];
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (bound(itemBoxes[items[i]]) >= smallest)
+                    continue;
+                double m = metric(items[i]);
+                if (m < smallest)
+                {
+                    smallest = m;
+                    found = items[i];
+                }
+            }
+            continue;
+        }
+
+        // The more promising child goes on top so it is searched first
+        double b0 = bound(nodes[node.first].box);
+        double b1 = bound(nodes[node.first + 1].box);
+        if (b0 < b1)
+        {
+            stack.push_back({ node.first + 1, b1 });
+            stack.push_back({ node.first, b0 });
+        }
+        else
+        {
+            stack.push_back({ node.first, b0 });
+            stack.push_back({ node.first + 1, b1 });
+        }
+    }
+    if (best)
+        *best = smallest;
+    return found;
+}
\ No newline at end of file
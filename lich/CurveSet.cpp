@@ -0,0 +1,470 @@
+#define _USE_MATH_DEFINES
+
+#include "CurveSet.h"
+#include "CurveVisit.h"
+#include "SinCos.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    template <class T>
+    void EraseSwap(std::vector<T>& v, size_t i)
+    {
+        v[i] = v.back();
+        v.pop_back();
+    }
+}
+
+CurveHandle CurveSet::pushCommon(Columns& columns, CurveKind kind, const Point3D& position, const Point3D& rotation)
+{
+    uint32_t slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        slot = (uint32_t)slots.size();
+        slots.push_back({ kind, false, 0, 0 });
+    }
+
+    Slot& s = slots[slot];
+    s.kind = kind;
+    s.live = true;
+    s.row = (uint32_t)columns.size();
+
+    columns.position.push_back(position);
+    columns.rotation.push_back(rotation);
+    columns.transform.push_back(Transform3D(position, rotation));
+    columns.slot.push_back(slot);
+    return { slot, s.generation };
+}
+
+CurveHandle CurveSet::addCircle(double radius, const Point3D& position, const Point3D& rotation)
+{
+    circleColumns.radius.push_back(radius);
+    return pushCommon(circleColumns, CurveKind::Circle, position, rotation);
+}
+
+CurveHandle CurveSet::addEllipse(double a, double b, const Point3D& position, const Point3D& rotation)
+{
+    ellipseColumns.a.push_back(a);
+    ellipseColumns.b.push_back(b);
+    return pushCommon(ellipseColumns, CurveKind::Ellipse, position, rotation);
+}
+
+CurveHandle CurveSet::addHelix(double radius, double step, int turns, const Point3D& position, const Point3D& rotation)
+{
+    helixColumns.radius.push_back(radius);
+    helixColumns.step.push_back(step);
+    helixColumns.turns.push_back(turns);
+    return pushCommon(helixColumns, CurveKind::Helix, position, rotation);
+}
+
+CurveHandle CurveSet::add(const Curve3D& curve)
+{
+    return VisitCurve(curve, Overloaded{
+        [&](const Circle3D& circle) { return addCircle(circle.getRadius(), circle.getPosition(), circle.getRotation()); },
+        [&](const Ellipse3D& ellipse) { return addEllipse(ellipse.getA(), ellipse.getB(), ellipse.getPosition(), ellipse.getRotation()); },
+        [&](const Helix3D& helix) { return addHelix(helix.getRadius(), helix.getStep(), helix.getTurns(), helix.getPosition(), helix.getRotation()); } });
+}
+
+void CurveSet::remove(CurveHandle handle)
+{
+    const Slot& slot = checkedSlot(handle);
+    size_t row = slot.row;
+    CurveKind kind = slot.kind;
+
+    Columns& columns = columnsOf(kind);
+    uint32_t movedSlot = columns.slot.back();
+    EraseSwap(columns.position, row);
+    EraseSwap(columns.rotation, row);
+    EraseSwap(columns.transform, row);
+    EraseSwap(columns.slot, row);
+    switch (kind)
+    {
+    case CurveKind::Circle:
+        EraseSwap(circleColumns.radius, row);
+        break;
+    case CurveKind::Ellipse:
+        EraseSwap(ellipseColumns.a, row);
+        EraseSwap(ellipseColumns.b, row);
+        break;
+    case CurveKind::Helix:
+        EraseSwap(helixColumns.radius, row);
+        EraseSwap(helixColumns.step, row);
+        EraseSwap(helixColumns.turns, row);
+        break;
+    }
+
+    slots[movedSlot].row = (uint32_t)row;
+    Slot& removed = slots[handle.slot];
+    removed.live = false;
+    ++removed.generation;
+    freeSlots.push_back(handle.slot);
+}
+
+void CurveSet::clear()
+{
+    circleColumns = CircleColumns();
+    ellipseColumns = EllipseColumns();
+    helixColumns = HelixColumns();
+    slots.clear();
+    freeSlots.clear();
+}
+
+void CurveSet::reserve(size_t circleCount, size_t ellipseCount, size_t helixCount)
+{
+    auto reserveCommon = [](Columns& columns, size_t n) {
+        columns.position.reserve(n);
+        columns.rotation.reserve(n);
+        columns.transform.reserve(n);
+        columns.slot.reserve(n);
+    };
+    reserveCommon(circleColumns, circleCount);
+    circleColumns.radius.reserve(circleCount);
+    reserveCommon(ellipseColumns, ellipseCount);
+    ellipseColumns.a.reserve(ellipseCount);
+    ellipseColumns.b.reserve(ellipseCount);
+    reserveCommon(helixColumns, helixCount);
+    helixColumns.radius.reserve(helixCount);
+    helixColumns.step.reserve(helixCount);
+    helixColumns.turns.reserve(helixCount);
+    slots.reserve(circleCount + ellipseCount + helixCount);
+}
+
+void CurveSet::assign(std::span<const CurveKind> kinds)
+{
+    clear();
+
+    size_t counts[3] = {};
+    for (CurveKind kind : kinds)
+        ++counts[(int)kind];
+
+    auto resizeCommon = [](Columns& columns, size_t n) {
+        columns.position.resize(n);
+        columns.rotation.resize(n);
+        columns.transform.resize(n);
+        columns.slot.resize(n);
+    };
+    resizeCommon(circleColumns, counts[(int)CurveKind::Circle]);
+    circleColumns.radius.resize(counts[(int)CurveKind::Circle]);
+    resizeCommon(ellipseColumns, counts[(int)CurveKind::Ellipse]);
+    ellipseColumns.a.resize(counts[(int)CurveKind::Ellipse]);
+    ellipseColumns.b.resize(counts[(int)CurveKind::Ellipse]);
+    resizeCommon(helixColumns, counts[(int)CurveKind::Helix]);
+    helixColumns.radius.resize(counts[(int)CurveKind::Helix]);
+    helixColumns.step.resize(counts[(int)CurveKind::Helix]);
+    helixColumns.turns.resize(counts[(int)CurveKind::Helix]);
+
+    uint32_t rows[3] = {};
+    slots.resize(kinds.size());
+    for (size_t i = 0; i < kinds.size(); ++i)
+    {
+        uint32_t row = rows[(int)kinds[i]]++;
+        slots[i] = { kinds[i], true, row, 0 };
+        columnsOf(kinds[i]).slot[row] = (uint32_t)i;
+    }
+}
+
+bool CurveSet::contains(CurveHandle handle) const
+{
+    return handle.slot < slots.size() && slots[handle.slot].live && slots[handle.slot].generation == handle.generation;
+}
+
+const CurveSet::Slot& CurveSet::checkedSlot(CurveHandle handle) const
+{
+    if (!contains(handle))
+        throw std::out_of_range("CurveSet: stale or invalid curve handle");
+    return slots[handle.slot];
+}
+
+CurveSet::Columns& CurveSet::columnsOf(CurveKind kind)
+{
+    return const_cast<Columns&>(static_cast<const CurveSet*>(this)->columnsOf(kind));
+}
+
+const CurveSet::Columns& CurveSet::columnsOf(CurveKind kind) const
+{
+    switch (kind)
+    {
+    case CurveKind::Circle: return circleColumns;
+    case CurveKind::Ellipse: return ellipseColumns;
+    default: return helixColumns;
+    }
+}
+
+CurveKind CurveSet::kind(CurveHandle handle) const
+{
+    return checkedSlot(handle).kind;
+}
+
+size_t CurveSet::row(CurveHandle handle) const
+{
+    return checkedSlot(handle).row;
+}
+
+CurveHandle CurveSet::handleAt(CurveKind kind, size_t row) const
+{
+    uint32_t slot = columnsOf(kind).slot.at(row);
+    return { slot, slots[slot].generation };
+}
+
+std::vector<CurveHandle> CurveSet::handles() const
+{
+    std::vector<CurveHandle> result;
+    result.reserve(size());
+    for (uint32_t i = 0; i < slots.size(); ++i)
+    {
+        if (slots[i].live)
+            result.push_back({ i, slots[i].generation });
+    }
+    return result;
+}
+
+Point3D CurveSet::getPoint(CurveHandle handle, double t) const
+{
+    const Slot& slot = checkedSlot(handle);
+    size_t r = slot.row;
+    switch (slot.kind)
+    {
+    case CurveKind::Circle:
+    {
+        double radius = circleColumns.radius[r];
+        return circleColumns.transform[r].applyPoint(radius * cos(t), radius * sin(t), 0.0);
+    }
+    case CurveKind::Ellipse:
+        return ellipseColumns.transform[r].applyPoint(ellipseColumns.a[r] * cos(t), ellipseColumns.b[r] * sin(t), 0.0);
+    default:
+    {
+        double radius = helixColumns.radius[r];
+        double scaled_t = t * helixColumns.turns[r];
+        return helixColumns.transform[r].applyPoint(radius * cos(scaled_t), radius * sin(scaled_t),
+            helixColumns.step[r] * scaled_t / (2 * M_PI));
+    }
+    }
+}
+
+Point3D CurveSet::getDerivative(CurveHandle handle, double t) const
+{
+    const Slot& slot = checkedSlot(handle);
+    size_t r = slot.row;
+    switch (slot.kind)
+    {
+    case CurveKind::Circle:
+    {
+        double radius = circleColumns.radius[r];
+        return circleColumns.transform[r].applyVector(-radius * sin(t), radius * cos(t), 0.0);
+    }
+    case CurveKind::Ellipse:
+        return ellipseColumns.transform[r].applyVector(-ellipseColumns.a[r] * sin(t), ellipseColumns.b[r] * cos(t), 0.0);
+    default:
+    {
+        double radius = helixColumns.radius[r];
+        int turns = helixColumns.turns[r];
+        double scaled_t = t * turns;
+        return helixColumns.transform[r].applyVector(-radius * turns * sin(scaled_t), radius * turns * cos(scaled_t),
+            (helixColumns.step[r] * turns) / (2 * M_PI));
+    }
+    }
+}
+
+CurveSample CurveSet::evaluate(CurveHandle handle, double t, int order) const
+{
+    const Slot& slot = checkedSlot(handle);
+    size_t r = slot.row;
+    // Local x and y amplitudes and rise per turn; circles and ellipses are
+    // flat, and every kind turns `rate` times as fast as t
+    double ax, by, step = 0.0;
+    double rate = 1.0;
+    const Transform3D* transform;
+    switch (slot.kind)
+    {
+    case CurveKind::Circle:
+        ax = by = circleColumns.radius[r];
+        transform = &circleColumns.transform[r];
+        break;
+    case CurveKind::Ellipse:
+        ax = ellipseColumns.a[r];
+        by = ellipseColumns.b[r];
+        transform = &ellipseColumns.transform[r];
+        break;
+    default:
+        ax = by = helixColumns.radius[r];
+        rate = helixColumns.turns[r];
+        step = helixColumns.step[r];
+        transform = &helixColumns.transform[r];
+        break;
+    }
+
+    double angle = t * rate;
+    double c = cos(angle);
+    double s = sin(angle);
+    CurveSample result;
+    result.point = transform->applyPoint(ax * c, by * s, step * angle / (2 * M_PI));
+    if (order >= 1)
+        result.derivative = transform->applyVector(-ax * rate * s, by * rate * c, (step * rate) / (2 * M_PI));
+    if (order >= 2)
+        result.secondDerivative = transform->applyVector(-ax * rate * rate * c, -by * rate * rate * s, 0.0);
+    return result;
+}
+
+Point3D CurveSet::getPosition(CurveHandle handle) const
+{
+    const Slot& slot = checkedSlot(handle);
+    return columnsOf(slot.kind).position[slot.row];
+}
+
+Point3D CurveSet::getRotation(CurveHandle handle) const
+{
+    const Slot& slot = checkedSlot(handle);
+    return columnsOf(slot.kind).rotation[slot.row];
+}
+
+void CurveSet::setPosition(CurveHandle handle, const Point3D& pos)
+{
+    const Slot& slot = checkedSlot(handle);
+    Columns& columns = columnsOf(slot.kind);
+    columns.position[slot.row] = pos;
+    columns.transform[slot.row].setTranslation(pos);
+}
+
+void CurveSet::setRotation(CurveHandle handle, const Point3D& rot)
+{
+    const Slot& slot = checkedSlot(handle);
+    Columns& columns = columnsOf(slot.kind);
+    columns.rotation[slot.row] = rot;
+    columns.transform[slot.row].setRotation(rot);
+}
+
+void CurveSet::setRadius(CurveHandle handle, double radius)
+{
+    const Slot& slot = checkedSlot(handle);
+    if (slot.kind == CurveKind::Circle)
+        circleColumns.radius[slot.row] = radius;
+    else if (slot.kind == CurveKind::Helix)
+        helixColumns.radius[slot.row] = radius;
+    else
+        throw std::invalid_argument("CurveSet: curve has no radius");
+}
+
+void CurveSet::setAxes(CurveHandle handle, double a, double b)
+{
+    const Slot& slot = checkedSlot(handle);
+    if (slot.kind != CurveKind::Ellipse)
+        throw std::invalid_argument("CurveSet: curve is not an ellipse");
+    ellipseColumns.a[slot.row] = a;
+    ellipseColumns.b[slot.row] = b;
+}
+
+void CurveSet::setStep(CurveHandle handle, double step)
+{
+    const Slot& slot = checkedSlot(handle);
+    if (slot.kind != CurveKind::Helix)
+        throw std::invalid_argument("CurveSet: curve is not a helix");
+    helixColumns.step[slot.row] = step;
+}
+
+void CurveSet::setTurns(CurveHandle handle, int turns)
+{
+    const Slot& slot = checkedSlot(handle);
+    if (slot.kind != CurveKind::Helix)
+        throw std::invalid_argument("CurveSet: curve is not a helix");
+    helixColumns.turns[slot.row] = turns;
+}
+
+void CurveSet::tessellate(int segments, std::vector<Point3D>& out) const
+{
+    if (segments <= 0)
+    {
+        out.clear();
+        return;
+    }
+    size_t stride = (size_t)segments + 1;
+    // Every element is overwritten below, so a reused buffer is not cleared first
+    out.resize(size() * stride);
+
+    // Every curve is sampled on the same t grid, so one sine/cosine table serves them all
+    std::vector<double> ts(stride), sines(stride), cosines(stride);
+    for (size_t i = 0; i < stride; ++i)
+        ts[i] = 2.0 * M_PI * ((double)i / segments);
+    SinCos(ts, sines, cosines);
+
+    Point3D* dst = out.data();
+    for (size_t r = 0; r < circleColumns.size(); ++r)
+    {
+        const Transform3D& m = circleColumns.transform[r];
+        double radius = circleColumns.radius[r];
+        for (size_t i = 0; i < stride; ++i)
+            *dst++ = m.applyPoint(radius * cosines[i], radius * sines[i], 0.0);
+    }
+
+    for (size_t r = 0; r < ellipseColumns.size(); ++r)
+    {
+        const Transform3D& m = ellipseColumns.transform[r];
+        double a = ellipseColumns.a[r];
+        double b = ellipseColumns.b[r];
+        for (size_t i = 0; i < stride; ++i)
+            *dst++ = m.applyPoint(a * cosines[i], b * sines[i], 0.0);
+    }
+
+    // turns is an integer, so turns * t lands on the same grid modulo 2pi
+    for (size_t r = 0; r < helixColumns.size(); ++r)
+    {
+        const Transform3D& m = helixColumns.transform[r];
+        double radius = helixColumns.radius[r];
+        long long turns = helixColumns.turns[r];
+        double rise = helixColumns.step[r] * turns / (2 * M_PI);
+        for (size_t i = 0; i < stride; ++i)
+        {
+            long long k = (turns * (long long)i) % segments;
+            if (k < 0) k += segments;
+            *dst++ = m.applyPoint(radius * cosines[k], radius * sines[k], rise * ts[i]);
+        }
+    }
+}
+
+std::shared_ptr<Curve3D> CurveSet::toCurve(CurveHandle handle) const
+{
+    const Slot& slot = checkedSlot(handle);
+    size_t r = slot.row;
+    std::shared_ptr<Curve3D> curve;
+    switch (slot.kind)
+    {
+    case CurveKind::Circle:
+        curve = std::make_shared<Circle3D>(circleColumns.radius[r]);
+        break;
+    case CurveKind::Ellipse:
+        curve = std::make_shared<Ellipse3D>(ellipseColumns.a[r], ellipseColumns.b[r]);
+        break;
+    case CurveKind::Helix:
+        curve = std::make_shared<Helix3D>(helixColumns.radius[r], helixColumns.step[r], helixColumns.turns[r]);
+        break;
+    }
+    const Columns& columns = columnsOf(slot.kind);
+    curve->setPosition(columns.position[r]);
+    curve->setRotation(columns.rotation[r]);
+    return curve;
+}
+
+std::vector<std::shared_ptr<Curve3D>> CurveSet::toCurves() const
+{
+    std::vector<std::shared_ptr<Curve3D>> curves;
+    curves.reserve(size());
+    for (CurveHandle handle : handles())
+        curves.push_back(toCurve(handle));
+    return curves;
+}
+
+CurveSet CurveSet::FromCurves(const std::vector<std::shared_ptr<Curve3D>>& curves)
+{
+    CurveSet set;
+    for (const auto& curve : curves)
+    {
+        if (curve)
+            set.add(*curve);
+    }
+    return set;
+}
\ No newline at end of file
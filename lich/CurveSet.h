@@ -0,0 +1,128 @@
+#pragma once
+#include "Curve3D.h"
+#include "Transform3D.h"
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Stable reference to a curve in a CurveSet. Stays valid until that curve
+// is removed; a handle to a removed curve is rejected even if its slot is reused.
+struct CurveHandle
+{
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+// Data-oriented curve container. Each curve kind is stored in its own
+// contiguous per-field columns, so passes over millions of curves stream
+// through memory instead of chasing one heap object per curve.
+// Column order within a kind is not stable across remove(); handles are.
+class CurveSet
+{
+public:
+    struct Columns
+    {
+        std::vector<Point3D> position;
+        std::vector<Point3D> rotation;
+        std::vector<Transform3D> transform;
+        std::vector<uint32_t> slot; // owning handle slot of each row
+
+        size_t size() const { return slot.size(); }
+    };
+
+    struct CircleColumns : Columns
+    {
+        std::vector<double> radius;
+    };
+
+    struct EllipseColumns : Columns
+    {
+        std::vector<double> a;
+        std::vector<double> b;
+    };
+
+    struct HelixColumns : Columns
+    {
+        std::vector<double> radius;
+        std::vector<double> step;
+        std::vector<int> turns;
+    };
+
+    CurveHandle addCircle(double radius, const Point3D& position = Point3D(), const Point3D& rotation = Point3D());
+    CurveHandle addEllipse(double a, double b, const Point3D& position = Point3D(), const Point3D& rotation = Point3D());
+    CurveHandle addHelix(double radius, double step, int turns, const Point3D& position = Point3D(), const Point3D& rotation = Point3D());
+    CurveHandle add(const Curve3D& curve);
+    void remove(CurveHandle handle);
+    void clear();
+    void reserve(size_t circleCount, size_t ellipseCount, size_t helixCount);
+
+    size_t size() const { return circleColumns.size() + ellipseColumns.size() + helixColumns.size(); }
+    bool empty() const { return size() == 0; }
+    bool contains(CurveHandle handle) const;
+    CurveKind kind(CurveHandle handle) const;
+    // Row of the curve inside the columns of its kind
+    size_t row(CurveHandle handle) const;
+    CurveHandle handleAt(CurveKind kind, size_t row) const;
+    // Live handles in slot order; freed slots are reused, so this is not insertion order
+    std::vector<CurveHandle> handles() const;
+
+    const CircleColumns& circles() const { return circleColumns; }
+    const EllipseColumns& ellipses() const { return ellipseColumns; }
+    const HelixColumns& helices() const { return helixColumns; }
+
+    Point3D getPoint(CurveHandle handle, double t) const;
+    Point3D getDerivative(CurveHandle handle, double t) const;
+    // As Curve3D::evaluate
+    CurveSample evaluate(CurveHandle handle, double t, int order = 2) const;
+    Point3D getPosition(CurveHandle handle) const;
+    Point3D getRotation(CurveHandle handle) const;
+
+    void setPosition(CurveHandle handle, const Point3D& pos);
+    void setRotation(CurveHandle handle, const Point3D& rot);
+    // Circle or helix radius
+    void setRadius(CurveHandle handle, double radius);
+    void setAxes(CurveHandle handle, double a, double b);
+    void setStep(CurveHandle handle, double step);
+    void setTurns(CurveHandle handle, int turns);
+
+    // Bulk loading for generators. assign() replaces the contents with one
+    // curve per element of kinds: curve i gets handle slot i and the next row
+    // of its kind, at the origin with zero parameters. The rows are then filled
+    // through the writable columns, which must keep transform in sync with
+    // position and rotation; different rows may be written from different threads.
+    void assign(std::span<const CurveKind> kinds);
+    CircleColumns& writableCircles() { return circleColumns; }
+    EllipseColumns& writableEllipses() { return ellipseColumns; }
+    HelixColumns& writableHelices() { return helixColumns; }
+
+    // Tessellates every curve at segments + 1 uniform t in [0, 2pi].
+    // out receives the polylines back to back: circles, then ellipses, then helices, in row order.
+    void tessellate(int segments, std::vector<Point3D>& out) const;
+
+    // Adapter to the Curve3D object API. toCurve returns a standalone copy;
+    // write changes back with the setters above.
+    std::shared_ptr<Curve3D> toCurve(CurveHandle handle) const;
+    std::vector<std::shared_ptr<Curve3D>> toCurves() const;
+    static CurveSet FromCurves(const std::vector<std::shared_ptr<Curve3D>>& curves);
+
+private:
+    struct Slot
+    {
+        CurveKind kind;
+        bool live;
+        uint32_t row;
+        uint32_t generation;
+    };
+
+    CircleColumns circleColumns;
+    EllipseColumns ellipseColumns;
+    HelixColumns helixColumns;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+
+    CurveHandle pushCommon(Columns& columns, CurveKind kind, const Point3D& position, const Point3D& rotation);
+    const Slot& checkedSlot(CurveHandle handle) const;
+    Columns& columnsOf(CurveKind kind);
+    const Columns& columnsOf(CurveKind kind) const;
+};
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#include "Circle.h"
+#include "Ellipse.h"
+#include "Helix.h"
+#include <memory>
+
+// Type dispatch on Curve3D::kind() in place of dynamic_pointer_cast chains.
+
+// Builds one callable out of several lambdas, one per concrete curve type
+template <class... Fs>
+struct Overloaded : Fs...
+{
+    using Fs::operator()...;
+};
+template <class... Fs>
+Overloaded(Fs...) -> Overloaded<Fs...>;
+
+// Calls f with the curve downcast to its concrete type
+template <class F>
+decltype(auto) VisitCurve(const Curve3D& curve, F&& f)
+{
+    switch (curve.kind())
+    {
+    case CurveKind::Circle: return f(static_cast<const Circle3D&>(curve));
+    case CurveKind::Ellipse: return f(static_cast<const Ellipse3D&>(curve));
+    default: return f(static_cast<const Helix3D&>(curve));
+    }
+}
+
+template <class F>
+decltype(auto) VisitCurve(Curve3D& curve, F&& f)
+{
+    switch (curve.kind())
+    {
+    case CurveKind::Circle: return f(static_cast<Circle3D&>(curve));
+    case CurveKind::Ellipse: return f(static_cast<Ellipse3D&>(curve));
+    default: return f(static_cast<Helix3D&>(curve));
+    }
+}
+
+// Downcasts without RTTI or reference counting; null if the curve is another kind
+template <class T>
+T* CurveAs(Curve3D* curve)
+{
+    return curve && curve->kind() == T::Kind ? static_cast<T*>(curve) : nullptr;
+}
+
+template <class T>
+const T* CurveAs(const Curve3D* curve)
+{
+    return curve && curve->kind() == T::Kind ? static_cast<const T*>(curve) : nullptr;
+}
+
+template <class T>
+T* CurveAs(const std::shared_ptr<Curve3D>& curve)
+{
+    return CurveAs<T>(curve.get());
+}
\ No newline at end of file
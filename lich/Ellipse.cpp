@@ -1,55 +1,286 @@
+#define _USE_MATH_DEFINES
+
 #include "Ellipse.h"
+#include "SinCos.h"
+#include <algorithm>
 
 Ellipse3D::Ellipse3D(double a, double b)
-    : a(a), b(b), position(0, 0, 0), rotation(0, 0, 0) {
+    : Curve3D(Kind), a(a), b(b), position(0, 0, 0), rotation(0, 0, 0) {
+    updateBounds();
 }
 
-Point3D Ellipse3D::getPoint(double t) const
+void Ellipse3D::updateBounds()
+{
+    setBounds(EllipseBounds(transform, a, b), { position, std::max(std::fabs(a), std::fabs(b)) });
+}
+
+namespace
+{
+    const double QuarterTurn = M_PI / 2;
+    // Intervals of the quarter-arc table, each integrated by 8-point Gauss-Legendre
+    const int ArcIntervals = 24;
+
+    const double GaussNodes[8] = {
+        -0.9602898564975363, -0.7966664774136267, -0.5255324099163290, -0.1834346424956498,
+        0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363 };
+    const double GaussWeights[8] = {
+        0.1012285362903763, 0.2223810344533745, 0.3137066458778873, 0.3626837833783620,
+        0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763 };
+}
+
+struct Ellipse3D::ArcTable
+{
+    double a;
+    double b;
+    double knots[ArcIntervals + 1];      // t at the interval ends
+    double cumulative[ArcIntervals + 1]; // arc length from 0 to each knot
+
+    ArcTable(double a, double b) : a(a), b(b)
+    {
+        // Knots crowd toward the end of the quarter where the curve is
+        // sharpest, which for a flat ellipse is a small part of the range
+        bool sharpAtZero = std::fabs(a) > std::fabs(b);
+        for (int k = 0; k <= ArcIntervals; ++k)
+        {
+            double x = (double)k / ArcIntervals;
+            knots[k] = sharpAtZero ? QuarterTurn * x * x : QuarterTurn * (1.0 - (1.0 - x) * (1.0 - x));
+        }
+        cumulative[0] = 0.0;
+        for (int k = 0; k < ArcIntervals; ++k)
+            cumulative[k + 1] = cumulative[k] + integrate(knots[k], knots[k + 1]);
+    }
+
+    // |dP/dt|; the transform is rigid, so that of the local ellipse
+    double speed(double t) const
+    {
+        double x = a * std::sin(t);
+        double y = b * std::cos(t);
+        return std::sqrt(x * x + y * y);
+    }
+
+    double integrate(double from, double to) const
+    {
+        double half = 0.5 * (to - from);
+        double middle = from + half;
+        double sum = 0.0;
+        for (int i = 0; i < 8; ++i)
+            sum += GaussWeights[i] * speed(middle + half * GaussNodes[i]);
+        return sum * half;
+    }
+
+    double quarter() const { return cumulative[ArcIntervals]; }
+
+    // Arc length from 0 to u in [0, pi/2]
+    double quarterArc(double u) const
+    {
+        int k = (int)(std::upper_bound(knots + 1, knots + ArcIntervals, u) - knots) - 1;
+        return cumulative[k] + integrate(knots[k], u);
+    }
+
+    // u in [0, pi/2] with quarterArc(u) = length: Newton's method inside the
+    // table interval that holds the answer, falling back to bisection
+    double inverseQuarterArc(double length) const
+    {
+        int k = (int)(std::upper_bound(cumulative + 1, cumulative + ArcIntervals, length) - cumulative) - 1;
+        double low = knots[k];
+        double high = knots[k + 1];
+        double span = cumulative[k + 1] - cumulative[k];
+        if (span <= 0.0)
+            return low;
+
+        double u = low + (high - low) * (length - cumulative[k]) / span;
+        for (int iteration = 0; iteration < 16; ++iteration)
+        {
+            double error = cumulative[k] + integrate(knots[k], u) - length;
+            if (std::fabs(error) <= 1e-14 * quarter())
+                break;
+            if (error > 0.0)
+                high = u;
+            else
+                low = u;
+            double derivative = speed(u);
+            double next = derivative > 0.0 ? u - error / derivative : low;
+            u = next > low && next < high ? next : 0.5 * (low + high);
+        }
+        return u;
+    }
+
+    double arcLength(double t) const
+    {
+        // Quarter n runs forward for even n and mirrored for odd n
+        double n = std::floor(t / QuarterTurn);
+        double u = t - n * QuarterTurn;
+        bool mirrored = std::fmod(std::fabs(n), 2.0) == 1.0;
+        return n * quarter() + (mirrored ? quarter() - quarterArc(QuarterTurn - u) : quarterArc(u));
+    }
+
+    double tForArcLength(double s) const
+    {
+        double total = 4.0 * quarter();
+        if (total <= 0.0)
+            return 0.0;
+        s = std::clamp(s, 0.0, total);
+        int n = std::min(3, (int)(s / quarter()));
+        double rest = s - n * quarter();
+        double u = n % 2 == 1 ? QuarterTurn - inverseQuarterArc(quarter() - rest) : inverseQuarterArc(rest);
+        return n * QuarterTurn + u;
+    }
+};
+
+std::shared_ptr<const Ellipse3D::ArcTable> Ellipse3D::arcLengths() const
 {
-    double x = a * cos(t);
-    double y = b * sin(t);
-    double z = 0.0;
+    std::shared_ptr<const ArcTable> table = arcTable.load();
+    if (!table)
+    {
+        // Concurrent callers may each build one; they are identical
+        table = std::make_shared<const ArcTable>(a, b);
+        arcTable.store(table);
+    }
+    return table;
+}
 
-    double cosX = cos(rotation.x), sinX = sin(rotation.x);
-    double cosY = cos(rotation.y), sinY = sin(rotation.y);
-    double cosZ = cos(rotation.z), sinZ = sin(rotation.z);
+double Ellipse3D::length() const
+{
+    return 4.0 * arcLengths()->quarter();
+}
 
-    double x1 = x * cosZ - y * sinZ;
-    double y1 = x * sinZ + y * cosZ;
-    double z1 = z;
+double Ellipse3D::arcLength(double t) const
+{
+    return arcLengths()->arcLength(t);
+}
 
-    double x2 = x1 * cosY + z1 * sinY;
-    double y2 = y1;
-    double z2 = -x1 * sinY + z1 * cosY;
+double Ellipse3D::tForArcLength(double s) const
+{
+    return arcLengths()->tForArcLength(s);
+}
 
-    double x3 = x2;
-    double y3 = y2 * cosX - z2 * sinX;
-    double z3 = y2 * sinX + z2 * cosX;
+void Ellipse3D::getArcLengthParameters(std::span<double> ts) const
+{
+    std::shared_ptr<const ArcTable> table = arcLengths();
+    double total = 4.0 * table->quarter();
+    if (total <= 0.0)
+    {
+        Curve3D::getArcLengthParameters(ts);
+        return;
+    }
 
-    return Point3D(x3 + position.x, y3 + position.y, z3 + position.z);
+    size_t n = ts.size();
+    for (size_t i = 0; i < n; ++i)
+        ts[i] = n > 1 ? table->tForArcLength(total * i / (n - 1)) : 0.0;
+    if (n > 1)
+        ts[n - 1] = 2.0 * M_PI;
+}
+
+Point3D Ellipse3D::getPoint(double t) const
+{
+    return transform.applyPoint(a * cos(t), b * sin(t), 0.0);
 }
 
 Point3D Ellipse3D::getDerivative(double t) const
 {
-    double dx = -a * sin(t);
-    double dy = b * cos(t);
-    double dz = 0.0;
+    return transform.applyVector(-a * sin(t), b * cos(t), 0.0);
+}
+
+Point3D Ellipse3D::getSecondDerivative(double t) const
+{
+    return transform.applyVector(-a * cos(t), -b * sin(t), 0.0);
+}
+
+CurveSample Ellipse3D::evaluate(double t, int order) const
+{
+    double c = cos(t);
+    double s = sin(t);
+    CurveSample result;
+    result.point = transform.applyPoint(a * c, b * s, 0.0);
+    if (order >= 1)
+        result.derivative = transform.applyVector(-a * s, b * c, 0.0);
+    if (order >= 2)
+        result.secondDerivative = transform.applyVector(-a * c, -b * s, 0.0);
+    return result;
+}
+
+void Ellipse3D::evaluate(std::span<const double> ts, std::span<CurveSample> out, int order) const
+{
+    double sines[SinCosBlock], cosines[SinCosBlock];
+
+    for (size_t first = 0; first < ts.size(); first += SinCosBlock)
+    {
+        size_t n = std::min(SinCosBlock, ts.size() - first);
+        SinCos(ts.subspan(first, n), sines, cosines);
 
-    double cosX = cos(rotation.x), sinX = sin(rotation.x);
-    double cosY = cos(rotation.y), sinY = sin(rotation.y);
-    double cosZ = cos(rotation.z), sinZ = sin(rotation.z);
+        for (size_t j = 0; j < n; ++j)
+        {
+            double c = cosines[j];
+            double s = sines[j];
 
-    double dx1 = dx * cosZ - dy * sinZ;
-    double dy1 = dx * sinZ + dy * cosZ;
-    double dz1 = dz;
+            CurveSample& sample = out[first + j];
+            sample.point = transform.applyPoint(a * c, b * s, 0.0);
+            sample.derivative = order >= 1 ? transform.applyVector(-a * s, b * c, 0.0) : Point3D();
+            sample.secondDerivative = order >= 2 ? transform.applyVector(-a * c, -b * s, 0.0) : Point3D();
+        }
+    }
+}
+
+// Planar: the binormal is the local z axis, flipped when a and b differ in
+// sign, and the curvature is |P' x P''| / |P'|^3 = |ab| / |P'|^3
+FrenetFrame Ellipse3D::frameAt(double c, double s) const
+{
+    FrenetFrame frame;
+    double dx = -a * s, dy = b * c;
+    double speed = std::sqrt(dx * dx + dy * dy);
+    if (speed == 0.0)
+        return frame;
+    dx /= speed;
+    dy /= speed;
+    frame.tangent = transform.applyVector(dx, dy, 0.0);
+    double area = a * b;
+    if (area == 0.0)
+        return frame;
+    double sign = area > 0.0 ? 1.0 : -1.0;
+    frame.normal = transform.applyVector(-sign * dy, sign * dx, 0.0);
+    frame.binormal = transform.applyVector(0.0, 0.0, sign);
+    frame.curvature = std::fabs(area) / (speed * speed * speed);
+    return frame;
+}
+
+FrenetFrame Ellipse3D::frenetFrame(double t) const
+{
+    return frameAt(cos(t), sin(t));
+}
+
+void Ellipse3D::frenetFrame(std::span<const double> ts, std::span<FrenetFrame> out) const
+{
+    double sines[SinCosBlock], cosines[SinCosBlock];
+
+    for (size_t first = 0; first < ts.size(); first += SinCosBlock)
+    {
+        size_t n = std::min(SinCosBlock, ts.size() - first);
+        SinCos(ts.subspan(first, n), sines, cosines);
+        for (size_t j = 0; j < n; ++j)
+            out[first + j] = frameAt(cosines[j], sines[j]);
+    }
+}
+
+void Ellipse3D::sample(std::span<const double> ts, std::span<Point3D> points, std::span<Point3D> derivatives) const
+{
+    double angles[SinCosBlock], sines[SinCosBlock], cosines[SinCosBlock];
 
-    double dx2 = dx1 * cosY + dz1 * sinY;
-    double dy2 = dy1;
-    double dz2 = -dx1 * sinY + dz1 * cosY;
+    for (size_t first = 0; first < ts.size(); first += SinCosBlock)
+    {
+        size_t n = std::min(SinCosBlock, ts.size() - first);
+        for (size_t j = 0; j < n; ++j)
+            angles[j] = ts[first + j];
+        SinCos(std::span<const double>(angles, n), sines, cosines);
 
-    double dx3 = dx2;
-    double dy3 = dy2 * cosX - dz2 * sinX;
-    double dz3 = dy2 * sinX + dz2 * cosX;
+        for (size_t j = 0; j < n; ++j)
+        {
+            double c = cosines[j];
+            double s = sines[j];
 
-    return Point3D(dx3, dy3, dz3);
+            if (!points.empty())
+                points[first + j] = transform.applyPoint(a * c, b * s, 0.0);
+            if (!derivatives.empty())
+                derivatives[first + j] = transform.applyVector(-a * s, b * c, 0.0);
+        }
+    }
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 #include "Curve3D.h"
+#include "Transform3D.h"
+#include <atomic>
 #include <cmath>
+#include <memory>
 
 class Ellipse3D : public Curve3D
 {
@@ -9,17 +12,57 @@ private:
     double b;
     Point3D position;
     Point3D rotation;
+    Transform3D transform;
+
+    // Arc length along the first quarter, t in [0, pi/2], where the other
+    // three quarters mirror it. Built on first use and dropped by setAxes().
+    struct ArcTable;
+    // Holder that is safe to fill from concurrent const calls; copies start empty
+    class ArcTableCache
+    {
+    public:
+        ArcTableCache() = default;
+        ArcTableCache(const ArcTableCache&) {}
+        ArcTableCache& operator=(const ArcTableCache&) { reset(); return *this; }
+
+        std::shared_ptr<const ArcTable> load() const { return table.load(std::memory_order_acquire); }
+        void store(std::shared_ptr<const ArcTable> built) const { table.store(std::move(built), std::memory_order_release); }
+        void reset() { table.store(nullptr); }
+
+    private:
+        mutable std::atomic<std::shared_ptr<const ArcTable>> table;
+    };
+    ArcTableCache arcTable;
+
+    void updateBounds();
+    // Frenet frame where the angle has cosine c and sine s
+    FrenetFrame frameAt(double c, double s) const;
+    std::shared_ptr<const ArcTable> arcLengths() const;
 
 public:
+    static constexpr CurveKind Kind = CurveKind::Ellipse;
+
     Ellipse3D(double a, double b);
 
     Point3D getPoint(double t) const override;
     Point3D getDerivative(double t) const override;
-    void setPosition(const Point3D& pos) override { position = pos; }
-    void setRotation(const Point3D& rot) override { rotation = rot; }
+    Point3D getSecondDerivative(double t) const override;
+    CurveSample evaluate(double t, int order = 2) const override;
+    void evaluate(std::span<const double> ts, std::span<CurveSample> out, int order = 2) const override;
+    FrenetFrame frenetFrame(double t) const override;
+    void frenetFrame(std::span<const double> ts, std::span<FrenetFrame> out) const override;
+    void sample(std::span<const double> ts, std::span<Point3D> points, std::span<Point3D> derivatives) const override;
+    double length() const override;
+    double arcLength(double t) const override;
+    double tForArcLength(double s) const override;
+    void getArcLengthParameters(std::span<double> ts) const override;
+    void setPosition(const Point3D& pos) override { position = pos; transform.setTranslation(pos); updateBounds(); touch(); }
+    void setRotation(const Point3D& rot) override { rotation = rot; transform.setRotation(rot); updateBounds(); touch(); }
     Point3D getRotation() const override { return rotation; }
 
     double getA() const { return a; }
     double getB() const { return b; }
     Point3D getPosition() const { return position; }
+
+    void setAxes(double newA, double newB) { a = newA; b = newB; arcTable.reset(); updateBounds(); touch(); }
 };
\ No newline at end of file
@@ -1,9 +1,38 @@
 ﻿#define _USE_MATH_DEFINES
 #include "Helix.h"
+#include "SinCos.h"
+#include <algorithm>
 #include <cmath>
 
 Helix3D::Helix3D(double radius, double step, int turns)
-    : radius(radius), step(step), turns(turns), position(0, 0, 0), rotation(0, 0, 0) {
+    : Curve3D(Kind), radius(radius), step(step), turns(turns), position(0, 0, 0), rotation(0, 0, 0) {
+    updateBounds();
+}
+
+// The helix winds around a cylinder from local z = 0 to step * turns
+void Helix3D::updateBounds()
+{
+    double height = step * turns;
+    Aabb box = EllipseBounds(transform, radius, radius, 0.0);
+    box.expand(EllipseBounds(transform, radius, radius, height));
+    setBounds(box, { transform.applyPoint(0.0, 0.0, 0.5 * height), std::hypot(radius, 0.5 * height) });
+}
+
+// The speed |dP/dt| is the same for every t
+double Helix3D::length() const
+{
+    return std::fabs(turns) * std::hypot(2 * M_PI * radius, step);
+}
+
+double Helix3D::arcLength(double t) const
+{
+    return length() * t / (2 * M_PI);
+}
+
+double Helix3D::tForArcLength(double s) const
+{
+    double total = length();
+    return total > 0.0 ? 2 * M_PI * std::clamp(s, 0.0, total) / total : 0.0;
 }
 
 Point3D Helix3D::getPoint(double t) const
@@ -13,23 +42,7 @@ Point3D Helix3D::getPoint(double t) const
     double y = radius * sin(scaled_t);
     double z = step * scaled_t / (2 * M_PI);
 
-    double cosX = cos(rotation.x), sinX = sin(rotation.x);
-    double cosY = cos(rotation.y), sinY = sin(rotation.y);
-    double cosZ = cos(rotation.z), sinZ = sin(rotation.z);
-
-    double x1 = x * cosZ - y * sinZ;
-    double y1 = x * sinZ + y * cosZ;
-    double z1 = z;
-
-    double x2 = x1 * cosY + z1 * sinY;
-    double y2 = y1;
-    double z2 = -x1 * sinY + z1 * cosY;
-
-    double x3 = x2;
-    double y3 = y2 * cosX - z2 * sinX;
-    double z3 = y2 * sinX + z2 * cosX;
-
-    return Point3D(x3 + position.x, y3 + position.y, z3 + position.z);
+    return transform.applyPoint(x, y, z);
 }
 
 Point3D Helix3D::getDerivative(double t) const
@@ -39,21 +52,132 @@ Point3D Helix3D::getDerivative(double t) const
     double dy = radius * turns * cos(scaled_t);
     double dz = (step * turns) / (2 * M_PI);
 
-    double cosX = cos(rotation.x), sinX = sin(rotation.x);
-    double cosY = cos(rotation.y), sinY = sin(rotation.y);
-    double cosZ = cos(rotation.z), sinZ = sin(rotation.z);
+    return transform.applyVector(dx, dy, dz);
+}
+
+Point3D Helix3D::getSecondDerivative(double t) const
+{
+    double scaled_t = t * turns;
+    double k = radius * turns * turns;
+    return transform.applyVector(-k * cos(scaled_t), -k * sin(scaled_t), 0.0);
+}
+
+CurveSample Helix3D::evaluate(double t, int order) const
+{
+    double scaled_t = t * turns;
+    double c = cos(scaled_t);
+    double s = sin(scaled_t);
+    CurveSample result;
+    result.point = transform.applyPoint(radius * c, radius * s, step * scaled_t / (2 * M_PI));
+    if (order >= 1)
+        result.derivative = transform.applyVector(-radius * turns * s, radius * turns * c, (step * turns) / (2 * M_PI));
+    if (order >= 2)
+    {
+        double k = radius * turns * turns;
+        result.secondDerivative = transform.applyVector(-k * c, -k * s, 0.0);
+    }
+    return result;
+}
+
+void Helix3D::evaluate(std::span<const double> ts, std::span<CurveSample> out, int order) const
+{
+    double rise = step / (2 * M_PI);
+    double k = radius * turns * turns;
+    double angles[SinCosBlock], sines[SinCosBlock], cosines[SinCosBlock];
+
+    for (size_t first = 0; first < ts.size(); first += SinCosBlock)
+    {
+        size_t n = std::min(SinCosBlock, ts.size() - first);
+        for (size_t j = 0; j < n; ++j)
+            angles[j] = ts[first + j] * turns;
+        SinCos(std::span<const double>(angles, n), sines, cosines);
+
+        for (size_t j = 0; j < n; ++j)
+        {
+            double c = cosines[j];
+            double s = sines[j];
 
-    double dx1 = dx * cosZ - dy * sinZ;
-    double dy1 = dx * sinZ + dy * cosZ;
-    double dz1 = dz;
+            CurveSample& sample = out[first + j];
+            sample.point = transform.applyPoint(radius * c, radius * s, rise * angles[j]);
+            sample.derivative = order >= 1 ? transform.applyVector(-radius * turns * s, radius * turns * c, rise * turns)
+                                           : Point3D();
+            sample.secondDerivative = order >= 2 ? transform.applyVector(-k * c, -k * s, 0.0) : Point3D();
+        }
+    }
+}
+
+// With h = step / 2pi: curvature |r| / (r^2 + h^2) and torsion h / (r^2 + h^2)
+// everywhere, the normal pointing at the axis
+FrenetFrame Helix3D::frameAt(double c, double s) const
+{
+    FrenetFrame frame;
+    double rise = step / (2 * M_PI);
+    double length = std::hypot(radius, rise);
+    if (turns == 0 || length == 0.0)
+        return frame;
+    // Negative turns run the same curve backwards
+    double direction = turns > 0 ? 1.0 : -1.0;
+    frame.tangent = transform.applyVector(-direction * radius * s / length, direction * radius * c / length,
+        direction * rise / length);
+    if (radius == 0.0)
+        return frame;
+    double sign = radius > 0.0 ? 1.0 : -1.0;
+    frame.normal = transform.applyVector(-sign * c, -sign * s, 0.0);
+    frame.binormal = transform.applyVector(direction * sign * rise * s / length, -direction * sign * rise * c / length,
+        direction * sign * radius / length);
+    frame.curvature = std::fabs(radius) / (length * length);
+    frame.torsion = rise / (length * length);
+    return frame;
+}
+
+FrenetFrame Helix3D::frenetFrame(double t) const
+{
+    double scaled_t = t * turns;
+    return frameAt(cos(scaled_t), sin(scaled_t));
+}
+
+void Helix3D::frenetFrame(std::span<const double> ts, std::span<FrenetFrame> out) const
+{
+    double angles[SinCosBlock], sines[SinCosBlock], cosines[SinCosBlock];
+
+    for (size_t first = 0; first < ts.size(); first += SinCosBlock)
+    {
+        size_t n = std::min(SinCosBlock, ts.size() - first);
+        for (size_t j = 0; j < n; ++j)
+            angles[j] = ts[first + j] * turns;
+        SinCos(std::span<const double>(angles, n), sines, cosines);
+        for (size_t j = 0; j < n; ++j)
+            out[first + j] = frameAt(cosines[j], sines[j]);
+    }
+}
+
+// Seeds from every turn; the ends are candidates too, the helix does not close
+CurvePoint Helix3D::closestPoint(const Point3D& p) const
+{
+    return closestPointNewton(p, std::abs(turns), false);
+}
+
+void Helix3D::sample(std::span<const double> ts, std::span<Point3D> points, std::span<Point3D> derivatives) const
+{
+    double rise = step / (2 * M_PI);
+    double angles[SinCosBlock], sines[SinCosBlock], cosines[SinCosBlock];
 
-    double dx2 = dx1 * cosY + dz1 * sinY;
-    double dy2 = dy1;
-    double dz2 = -dx1 * sinY + dz1 * cosY;
+    for (size_t first = 0; first < ts.size(); first += SinCosBlock)
+    {
+        size_t n = std::min(SinCosBlock, ts.size() - first);
+        for (size_t j = 0; j < n; ++j)
+            angles[j] = ts[first + j] * turns;
+        SinCos(std::span<const double>(angles, n), sines, cosines);
 
-    double dx3 = dx2;
-    double dy3 = dy2 * cosX - dz2 * sinX;
-    double dz3 = dy2 * sinX + dz2 * cosX;
+        for (size_t j = 0; j < n; ++j)
+        {
+            double c = cosines[j];
+            double s = sines[j];
 
-    return Point3D(dx3, dy3, dz3);
+            if (!points.empty())
+                points[first + j] = transform.applyPoint(radius * c, radius * s, rise * angles[j]);
+            if (!derivatives.empty())
+                derivatives[first + j] = transform.applyVector(-radius * turns * s, radius * turns * c, rise * turns);
+        }
+    }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "Curve3D.h"
+#include "Transform3D.h"
 
 #define _USE_MATH_DEFINES
 #include <cmath>
@@ -12,14 +13,31 @@ private:
     int turns;
     Point3D position;
     Point3D rotation;
+    Transform3D transform;
+
+    void updateBounds();
+    // Frenet frame where the angle has cosine c and sine s
+    FrenetFrame frameAt(double c, double s) const;
 
 public:
+    static constexpr CurveKind Kind = CurveKind::Helix;
+
     Helix3D(double radius, double step, int turns = 5);
 
     Point3D getPoint(double t) const override;
     Point3D getDerivative(double t) const override;
-    void setPosition(const Point3D& pos) override { position = pos; }
-    void setRotation(const Point3D& rot) override { rotation = rot; }
+    Point3D getSecondDerivative(double t) const override;
+    CurveSample evaluate(double t, int order = 2) const override;
+    void evaluate(std::span<const double> ts, std::span<CurveSample> out, int order = 2) const override;
+    FrenetFrame frenetFrame(double t) const override;
+    void frenetFrame(std::span<const double> ts, std::span<FrenetFrame> out) const override;
+    CurvePoint closestPoint(const Point3D& p) const override;
+    void sample(std::span<const double> ts, std::span<Point3D> points, std::span<Point3D> derivatives) const override;
+    double length() const override;
+    double arcLength(double t) const override;
+    double tForArcLength(double s) const override;
+    void setPosition(const Point3D& pos) override { position = pos; transform.setTranslation(pos); updateBounds(); touch(); }
+    void setRotation(const Point3D& rot) override { rotation = rot; transform.setRotation(rot); updateBounds(); touch(); }
     Point3D getRotation() const override { return rotation; }
 
     double getRadius() const { return radius; }
@@ -27,7 +45,7 @@ public:
     int getTurns() const { return turns; }
     Point3D getPosition() const { return position; }
 
-    void setRadius(double r) { radius = r; }
-    void setStep(double s) { step = s; }
-    void setTurns(int t) { turns = t; }
+    void setRadius(double r) { radius = r; updateBounds(); touch(); }
+    void setStep(double s) { step = s; updateBounds(); touch(); }
+    void setTurns(int t) { turns = t; updateBounds(); touch(); }
 };
\ No newline at end of file
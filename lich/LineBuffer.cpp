@@ -0,0 +1,23 @@
+#include "LineBuffer.h"
+
+void LineBuffer::addPolyline(std::span<const Vec3f> points, Rgba8 color)
+{
+    if (points.size() < 2) return;
+
+    size_t first = vertexData.size();
+    vertexData.resize(first + 2 * (points.size() - 1));
+    LineVertex* dst = vertexData.data() + first;
+    for (size_t i = 1; i < points.size(); ++i)
+    {
+        const Vec3f& a = points[i - 1];
+        const Vec3f& b = points[i];
+        *dst++ = { a.x, a.y, a.z, color };
+        *dst++ = { b.x, b.y, b.z, color };
+    }
+}
+
+void LineBuffer::addLine(const Vec3f& a, const Vec3f& b, Rgba8 color)
+{
+    vertexData.push_back({ a.x, a.y, a.z, color });
+    vertexData.push_back({ b.x, b.y, b.z, color });
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+#include "Tessellation.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct Rgba8
+{
+    uint8_t r, g, b, a;
+};
+
+// Interleaved position/colour vertex, 16 bytes
+struct LineVertex
+{
+    float x, y, z;
+    Rgba8 color;
+};
+
+// Line-list vertex array for a whole frame. Building it needs no GL
+// context; the renderer submits the finished array in one pass.
+class LineBuffer
+{
+public:
+    void clear() { vertexData.clear(); }
+    void reserve(size_t vertexCount) { vertexData.reserve(vertexCount); }
+
+    // Adds the polyline as separate segments, two vertices per segment
+    void addPolyline(std::span<const Vec3f> points, Rgba8 color);
+    void addLine(const Vec3f& a, const Vec3f& b, Rgba8 color);
+
+    const std::vector<LineVertex>& vertices() const { return vertexData; }
+    size_t lineCount() const { return vertexData.size() / 2; }
+
+private:
+    std::vector<LineVertex> vertexData;
+};
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "OutputWriter.h"
+#include <cstring>
+#include <stdexcept>
+
+OutputWriter::OutputWriter(OutputFormat format) : OutputWriter(stdout, format) {}
+
+OutputWriter::OutputWriter(std::FILE* file, OutputFormat format)
+    : file(file), outputFormat(format), buffer(new char[BufferSize]) {
+}
+
+OutputWriter::OutputWriter(const std::string& path, OutputFormat format)
+    : target(std::make_unique<AtomicFile>(path)), outputFormat(format), buffer(new char[BufferSize])
+{
+    file = target->get();
+}
+
+OutputWriter::~OutputWriter()
+{
+    // An unclosed file writer is abandoned: its AtomicFile drops the
+    // temporary file. A closed one has nothing left to flush.
+    if (target || !file)
+        return;
+    try
+    {
+        flush();
+    }
+    catch (const std::exception&)
+    {
+    }
+}
+
+void OutputWriter::writeBuffer()
+{
+    size_t size = used;
+    used = 0;
+    if (size > 0 && std::fwrite(buffer.get(), 1, size, file) != size)
+        throw std::runtime_error("output write failed");
+}
+
+void OutputWriter::flush()
+{
+    writeBuffer();
+    if (std::fflush(file) != 0)
+        throw std::runtime_error("output write failed");
+}
+
+void OutputWriter::close()
+{
+    if (!target)
+    {
+        flush();
+        return;
+    }
+    writeBuffer();
+    target->commit();
+    target.reset();
+    file = nullptr;
+}
+
+OutputWriter& OutputWriter::operator<<(std::string_view text)
+{
+    if (text.size() > BufferSize)
+    {
+        writeBuffer();
+        if (std::fwrite(text.data(), 1, text.size(), file) != text.size())
+            throw std::runtime_error("output write failed");
+        return *this;
+    }
+    std::memcpy(reserve(text.size()), text.data(), text.size());
+    used += text.size();
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(char c)
+{
+    *reserve(1) = c;
+    ++used;
+    return *this;
+}
+
+void OutputWriter::putNumber(double value)
+{
+    char* first = buffer.get() + used;
+    char* last = first + MaxFieldSize;
+    if (outputFormat == OutputFormat::Text)
+        used += std::to_chars(first, last, value, std::chars_format::general, 6).ptr - first;
+    else
+        used += std::to_chars(first, last, value).ptr - first;
+}
+
+OutputWriter& OutputWriter::operator<<(double value)
+{
+    reserve(MaxFieldSize);
+    putNumber(value);
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(const Point3D& point)
+{
+    reserve(MaxFieldSize);
+    if (outputFormat == OutputFormat::Text)
+    {
+        *this << '(';
+        putNumber(point.x);
+        *this << ", ";
+        putNumber(point.y);
+        *this << ", ";
+        putNumber(point.z);
+        *this << ')';
+    }
+    else
+    {
+        putNumber(point.x);
+        *this << ',';
+        putNumber(point.y);
+        *this << ',';
+        putNumber(point.z);
+    }
+    return *this;
+}
\ No newline at end of file
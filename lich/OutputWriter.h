@@ -0,0 +1,84 @@
+#pragma once
+#include "AtomicFile.h"
+#include "Point3D.h"
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Text: numbers as std::cout prints them by default (6 significant digits),
+// points as "(x, y, z)". Csv: numbers in the shortest form that reads back
+// to the same double, points as three fields "x,y,z".
+enum class OutputFormat
+{
+    Text,
+    Csv
+};
+
+// Buffered text output formatted with std::to_chars. Everything goes into
+// one large buffer that is written with a single fwrite whenever it fills,
+// and on flush() or destruction; nothing is flushed per line.
+class OutputWriter
+{
+public:
+    // Writes to stdout
+    explicit OutputWriter(OutputFormat format = OutputFormat::Text);
+    // Writes to an open stream, which stays open
+    OutputWriter(std::FILE* file, OutputFormat format);
+    // Writes to path + ".tmp", which close() renames over path; without
+    // close() the temporary file is removed and an existing file at path is
+    // left as it was. Throws std::runtime_error if it cannot be opened.
+    OutputWriter(const std::string& path, OutputFormat format);
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+    // Flushes; write errors are lost here, call flush() to see them
+    ~OutputWriter();
+
+    OutputFormat format() const { return outputFormat; }
+
+    OutputWriter& operator<<(std::string_view text);
+    OutputWriter& operator<<(const char* text) { return *this << std::string_view(text); }
+    OutputWriter& operator<<(char c);
+    OutputWriter& operator<<(double value);
+    OutputWriter& operator<<(const Point3D& point);
+    template <std::integral T>
+    OutputWriter& operator<<(T value);
+
+    // Throws std::runtime_error if the data could not be written
+    void flush();
+    // Flushes; a writer opened on a path then replaces the file at path and
+    // may not be written to afterwards
+    void close();
+
+private:
+    static const size_t BufferSize = size_t(1) << 20;
+    // Longest formatted number or point
+    static const size_t MaxFieldSize = 128;
+
+    std::FILE* file;
+    std::unique_ptr<AtomicFile> target; // set when opened on a path
+    OutputFormat outputFormat;
+    std::unique_ptr<char[]> buffer;
+    size_t used = 0;
+
+    void writeBuffer();
+    // Room for n more characters, flushing first if needed
+    char* reserve(size_t n)
+    {
+        if (used + n > BufferSize)
+            writeBuffer();
+        return buffer.get() + used;
+    }
+    void putNumber(double value);
+};
+
+template <std::integral T>
+OutputWriter& OutputWriter::operator<<(T value)
+{
+    char* first = reserve(MaxFieldSize);
+    used += std::to_chars(first, first + MaxFieldSize, value).ptr - first;
+    return *this;
+}
\ No newline at end of file
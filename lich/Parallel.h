@@ -0,0 +1,163 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Items per chunk for work whose result must not depend on the thread
+// count: chunk boundaries are fixed, only their assignment to threads varies
+const size_t ParallelChunk = 16384;
+
+// Worker count for a request of `threads`; 0 means one per hardware thread
+inline unsigned ResolveThreadCount(unsigned threads)
+{
+    // Queried once: on some platforms it reads the system configuration every call
+    static const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    return threads == 0 ? hardware : threads;
+}
+
+// Calls body(begin, end) on contiguous ranges that together cover [0, count),
+// one range per worker, the first one on the calling thread. Every range
+// holds at least `grain` items, so small counts run inline without spawning
+// anything. The first exception thrown by a range is rethrown once all
+// workers have finished.
+template <class Body>
+void ParallelFor(size_t count, unsigned threads, size_t grain, Body&& body)
+{
+    grain = std::max<size_t>(grain, 1);
+    size_t workers = std::min<size_t>(ResolveThreadCount(threads), (count + grain - 1) / grain);
+    if (workers <= 1)
+    {
+        if (count > 0)
+            body(size_t(0), count);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(workers);
+    auto run = [&](size_t worker) {
+        try
+        {
+            body(count * worker / workers, count * (worker + 1) / workers);
+        }
+        catch (...)
+        {
+            errors[worker] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; ++worker)
+    {
+        try
+        {
+            pool.emplace_back(run, worker);
+        }
+        catch (const std::system_error&)
+        {
+            // Out of threads: do this range here instead
+            run(worker);
+        }
+    }
+    run(0);
+    for (std::thread& thread : pool)
+        thread.join();
+
+    for (const std::exception_ptr& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+// Neumaier's compensated summation: the rounding error stays at a few ulps
+// of the result instead of growing with the number of terms
+class CompensatedSum
+{
+public:
+    void add(double x)
+    {
+        double t = sum + x;
+        if (std::fabs(sum) >= std::fabs(x))
+            compensation += (sum - t) + x;
+        else
+            compensation += (x - t) + sum;
+        sum = t;
+    }
+
+    void add(const CompensatedSum& other)
+    {
+        add(other.sum);
+        add(other.compensation);
+    }
+
+    double value() const { return sum + compensation; }
+
+private:
+    double sum = 0.0;
+    double compensation = 0.0;
+};
+
+// Compensated sum of value(i) for i in [0, count). Every ParallelChunk is
+// summed on its own and the partial sums are combined in chunk order, so the
+// result is bit-identical for any thread count.
+template <class Value>
+double ParallelSum(size_t count, unsigned threads, Value&& value)
+{
+    size_t chunks = (count + ParallelChunk - 1) / ParallelChunk;
+    std::vector<CompensatedSum> partial(chunks);
+    ParallelFor(chunks, threads, 1, [&](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk)
+        {
+            size_t end = std::min(count, (chunk + 1) * ParallelChunk);
+            for (size_t i = chunk * ParallelChunk; i < end; ++i)
+                partial[chunk].add(value(i));
+        }
+    });
+
+    CompensatedSum total;
+    for (const CompensatedSum& p : partial)
+        total.add(p);
+    return total.value();
+}
+
+// Order-preserving parallel filter: out receives every items[i] with
+// keep(items[i]), in the order of items. Chunks count their survivors, a
+// prefix sum gives each chunk its output offset, then chunks copy in parallel.
+template <class T, class U, class Keep, class Convert>
+void ParallelCompact(const std::vector<T>& items, std::vector<U>& out, unsigned threads, Keep&& keep, Convert&& convert)
+{
+    size_t count = items.size();
+    size_t chunks = (count + ParallelChunk - 1) / ParallelChunk;
+    std::vector<size_t> offsets(chunks + 1, 0);
+    ParallelFor(chunks, threads, 1, [&](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk)
+        {
+            size_t end = std::min(count, (chunk + 1) * ParallelChunk);
+            size_t kept = 0;
+            for (size_t i = chunk * ParallelChunk; i < end; ++i)
+                kept += keep(items[i]) ? 1 : 0;
+            offsets[chunk + 1] = kept;
+        }
+    });
+    for (size_t chunk = 0; chunk < chunks; ++chunk)
+        offsets[chunk + 1] += offsets[chunk];
+
+    out.clear();
+    out.resize(offsets[chunks]);
+    ParallelFor(chunks, threads, 1, [&](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk)
+        {
+            size_t end = std::min(count, (chunk + 1) * ParallelChunk);
+            size_t next = offsets[chunk];
+            for (size_t i = chunk * ParallelChunk; i < end; ++i)
+            {
+                if (keep(items[i]))
+                    out[next++] = convert(items[i]);
+            }
+        }
+    });
+}
\ No newline at end of file
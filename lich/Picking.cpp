@@ -0,0 +1,231 @@
+#define _USE_MATH_DEFINES
+#include "Picking.h"
+#include "CurveVisit.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const int SamplesPerTurn = 32;
+    // Each step keeps 0.618 of the bracket: 2pi / 32 shrinks below 1e-10
+    const int GoldenSteps = 48;
+
+    // Squared tangent of the angle between the ray and the direction to a
+    // point, from the cross product so that small angles keep their digits
+    struct RayMeasure
+    {
+        Point3D origin;
+        Point3D direction; // unit length
+
+        explicit RayMeasure(const Ray3D& ray) : origin(ray.origin), direction(ray.direction)
+        {
+            double length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+            direction = Point3D(direction.x / length, direction.y / length, direction.z / length);
+        }
+
+        double operator()(const Point3D& p) const
+        {
+            double wx = p.x - origin.x, wy = p.y - origin.y, wz = p.z - origin.z;
+            double s = wx * direction.x + wy * direction.y + wz * direction.z;
+            if (!(s > 0.0))
+                return INFINITY;
+            double cx = wy * direction.z - wz * direction.y;
+            double cy = wz * direction.x - wx * direction.z;
+            double cz = wx * direction.y - wy * direction.x;
+            return (cx * cx + cy * cy + cz * cz) / (s * s);
+        }
+    };
+
+    // Upper bound of |getDerivative(t)|: a point between two samples h apart
+    // in t is within maxSpeed * h / 2 of one of them
+    double MaxSpeed(const Curve3D& curve)
+    {
+        return VisitCurve(curve, Overloaded{
+            [](const Circle3D& circle) { return std::fabs(circle.getRadius()); },
+            [](const Ellipse3D& ellipse) { return std::max(std::fabs(ellipse.getA()), std::fabs(ellipse.getB())); },
+            [](const Helix3D& helix) {
+                return std::abs(helix.getTurns()) * std::hypot(helix.getRadius(), helix.getStep() / (2.0 * M_PI));
+            } });
+    }
+
+    // Minimum of the measure for t in [a, b]
+    double GoldenSection(const Curve3D& curve, const RayMeasure& measure, double a, double b, double& t)
+    {
+        const double r = 0.5 * (3.0 - std::sqrt(5.0));
+        double x1 = a + r * (b - a);
+        double x2 = b - r * (b - a);
+        double f1 = measure(curve.getPoint(x1));
+        double f2 = measure(curve.getPoint(x2));
+        for (int k = 0; k < GoldenSteps; ++k)
+        {
+            if (f1 < f2)
+            {
+                b = x2;
+                x2 = x1;
+                f2 = f1;
+                x1 = a + r * (b - a);
+                f1 = measure(curve.getPoint(x1));
+            }
+            else
+            {
+                a = x1;
+                x1 = x2;
+                f1 = f2;
+                x2 = b - r * (b - a);
+                f2 = measure(curve.getPoint(x2));
+            }
+        }
+        t = f1 < f2 ? x1 : x2;
+        return std::min(f1, f2);
+    }
+}
+
+double RayCurveAngle(const Curve3D& curve, const Ray3D& ray, double* t, double limit)
+{
+    const Helix3D* helix = CurveAs<Helix3D>(&curve);
+    // Circles and ellipses close up, so their first and last samples are neighbours
+    bool closed = helix == nullptr;
+    int n = SamplesPerTurn * (helix ? std::max(1, std::abs(helix->getTurns())) : 1);
+
+    // Reused from call to call: a pick measures every curve near the ray
+    thread_local std::vector<double> ts;
+    thread_local std::vector<Point3D> points;
+    thread_local std::vector<double> values;
+    ts.resize(n + 1);
+    points.resize(n + 1);
+    values.resize(n + 1);
+    double h = 2.0 * M_PI / n;
+    for (int i = 0; i <= n; ++i)
+        ts[i] = h * i;
+    curve.getPoints(ts, points);
+
+    RayMeasure measure(ray);
+    for (int i = 0; i <= n; ++i)
+        values[i] = measure(points[i]);
+
+    // Every point of the curve is within reach of a sample. A sample that
+    // is further than that from the cone of half-angle limit around the ray
+    // cannot have a neighbour inside it; perp cos(limit) - s sin(limit)
+    // never exceeds the distance to the cone, also for points behind the origin
+    double reach = 0.5 * h * MaxSpeed(curve);
+    double cosine = std::cos(limit), sine = std::sin(limit);
+    auto outsideCone = [&](const Point3D& p) {
+        double wx = p.x - ray.origin.x, wy = p.y - ray.origin.y, wz = p.z - ray.origin.z;
+        const Point3D& d = measure.direction;
+        double s = wx * d.x + wy * d.y + wz * d.z;
+        double cx = wy * d.z - wz * d.y, cy = wz * d.x - wx * d.z, cz = wx * d.y - wy * d.x;
+        return std::sqrt(cx * cx + cy * cy + cz * cz) * cosine - s * sine > reach;
+    };
+    if (limit < 0.5 * M_PI && std::all_of(points.begin(), points.end(), outsideCone))
+    {
+        if (t)
+            *t = 0.0;
+        return limit;
+    }
+
+    double best = INFINITY;
+    double bestT = 0.0;
+    double coneAngle = limit;
+    // The last sample repeats the first on a closed curve
+    int last = closed ? n - 1 : n;
+    for (int i = 0; i <= last; ++i)
+    {
+        double left = i > 0 ? values[i - 1] : closed ? values[n - 1] : INFINITY;
+        double right = i < n ? values[i + 1] : INFINITY;
+        if (values[i] == INFINITY || values[i] > left || values[i] > right)
+            continue;
+
+        // The bracket is covered by the balls around samples i - 1, i and
+        // i + 1; skip it if none of them reaches below the best so far
+        double bound = std::min(limit, std::atan(std::sqrt(best)));
+        if (bound != coneAngle)
+        {
+            coneAngle = bound;
+            cosine = std::cos(bound);
+            sine = std::sin(bound);
+        }
+        int before = i > 0 ? i - 1 : closed ? n - 1 : i;
+        int after = i < n ? i + 1 : i;
+        if (bound < 0.5 * M_PI && outsideCone(points[before]) && outsideCone(points[i]) && outsideCone(points[after]))
+            continue;
+
+        // The true minimum lies within one step of a sampled one; a closed
+        // curve continues past both ends, an open one stops there
+        double a = i > 0 || closed ? ts[i] - h : ts[i];
+        double b = i < n ? ts[i] + h : ts[i];
+        double refinedT;
+        double refined = GoldenSection(curve, measure, a, b, refinedT);
+        if (values[i] <= refined)
+        {
+            refined = values[i];
+            refinedT = ts[i];
+        }
+        if (refined < best)
+        {
+            best = refined;
+            bestT = refinedT;
+        }
+    }
+
+    if (t)
+        *t = closed && bestT < 0.0 ? bestT + 2.0 * M_PI : bestT;
+    return std::atan(std::sqrt(best));
+}
+
+double RayBoxAngle(const Ray3D& ray, const Aabb& box)
+{
+    Point3D e = box.extents();
+    return RaySphereAngle(ray, { box.center(), std::sqrt(e.x * e.x + e.y * e.y + e.z * e.z) });
+}
+
+double RaySphereAngle(const Ray3D& ray, const BoundingSphere& sphere)
+{
+    // No point of the sphere is closer in angle than its nearest edge
+    const Point3D& c = sphere.center;
+    double radius = sphere.radius;
+    double vx = c.x - ray.origin.x, vy = c.y - ray.origin.y, vz = c.z - ray.origin.z;
+    double distance = std::sqrt(vx * vx + vy * vy + vz * vz);
+    if (distance <= radius)
+        return 0.0;
+
+    const Point3D& d = ray.direction;
+    double length = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+    double cosine = (vx * d.x + vy * d.y + vz * d.z) / (distance * length);
+    double angle = std::acos(std::clamp(cosine, -1.0, 1.0));
+    return std::max(0.0, angle - std::asin(radius / distance));
+}
+
+double PixelsToAngle(double pixels, double fovyDegrees, int screenHeight)
+{
+    return std::atan(pixels * 2.0 * std::tan(fovyDegrees * M_PI / 360.0) / screenHeight);
+}
+
+CurvePick PickCurve(const CurveBvh& bvh, const std::vector<std::shared_ptr<Curve3D>>& curves, const Ray3D& ray,
+    double maxAngle)
+{
+    CurvePick pick;
+    double bestAngle = maxAngle;
+    uint32_t item = bvh.search([&](const Aabb& box) { return RayBoxAngle(ray, box); },
+        [&](uint32_t i) {
+            // The curve's own sphere is tighter than the one around its box
+            double angle = RaySphereAngle(ray, curves[i]->boundingSphere());
+            if (angle >= bestAngle)
+                return angle;
+            double t;
+            angle = RayCurveAngle(*curves[i], ray, &t, bestAngle);
+            // search() keeps exactly the items that beat the best so far
+            if (angle < bestAngle)
+            {
+                bestAngle = angle;
+                pick.t = t;
+            }
+            return angle;
+        },
+        maxAngle, &bestAngle);
+    if (item != CurveBvh::None)
+    {
+        pick.curve = (long)item;
+        pick.angle = bestAngle;
+    }
+    return pick;
+}
\ No newline at end of file
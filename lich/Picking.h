@@ -0,0 +1,38 @@
+#pragma once
+#include "Bounds.h"
+#include "Curve3D.h"
+#include "CurveBvh.h"
+#include <memory>
+#include <vector>
+
+// Picking measures how far a curve is from a ray by angle, as seen from the
+// ray origin, so a tolerance of a few pixels means the same at any depth.
+
+struct CurvePick
+{
+    long curve = -1;    // index into the curve list, -1 if nothing is within tolerance
+    double t = 0.0;     // curve parameter of the point nearest the ray
+    double angle = 0.0; // radians between the ray and that point
+};
+
+// Smallest angle between ray.direction and the direction from ray.origin to
+// a point of the curve, over the whole parameter range. Every local minimum
+// on a grid of samples (per turn for a helix) is narrowed down by
+// golden-section search on exact curve points, so no polyline error enters.
+// INFINITY if the curve is entirely behind the origin.
+//
+// A curve whose samples show it cannot come closer than limit is rejected
+// without the search; the result is then some angle >= limit.
+double RayCurveAngle(const Curve3D& curve, const Ray3D& ray, double* t = nullptr, double limit = INFINITY);
+
+// Lower bounds of RayCurveAngle for anything inside box or sphere
+double RayBoxAngle(const Ray3D& ray, const Aabb& box);
+double RaySphereAngle(const Ray3D& ray, const BoundingSphere& sphere);
+
+// Half-angle of the cone that covers pixels pixels around the view center
+double PixelsToAngle(double pixels, double fovyDegrees, int screenHeight);
+
+// The curve closest to the ray by angle, if that is less than maxAngle. bvh
+// must have been built from curves.
+CurvePick PickCurve(const CurveBvh& bvh, const std::vector<std::shared_ptr<Curve3D>>& curves, const Ray3D& ray,
+    double maxAngle);
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "RadiusIndex.h"
+#include <stdexcept>
+
+namespace
+{
+    // SplitMix64 finalizer; priorities only need to look random
+    uint64_t Priority(uint64_t id)
+    {
+        id += 0x9e3779b97f4a7c15ull;
+        id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9ull;
+        id = (id ^ (id >> 27)) * 0x94d049bb133111ebull;
+        return id ^ (id >> 31);
+    }
+}
+
+bool RadiusIndex::less(uint32_t t, double radius, uint64_t id) const
+{
+    return nodes[t].radius < radius || (nodes[t].radius == radius && nodes[t].id < id);
+}
+
+void RadiusIndex::pull(uint32_t t)
+{
+    Node& n = nodes[t];
+    n.count = 1;
+    n.sum = n.radius;
+    if (n.left != None)
+    {
+        n.count += nodes[n.left].count;
+        n.sum += nodes[n.left].sum;
+    }
+    if (n.right != None)
+    {
+        n.count += nodes[n.right].count;
+        n.sum += nodes[n.right].sum;
+    }
+}
+
+void RadiusIndex::split(uint32_t t, double radius, uint64_t id, uint32_t& left, uint32_t& right)
+{
+    if (t == None)
+    {
+        left = right = None;
+        return;
+    }
+    if (less(t, radius, id))
+    {
+        split(nodes[t].right, radius, id, nodes[t].right, right);
+        left = t;
+    }
+    else
+    {
+        split(nodes[t].left, radius, id, left, nodes[t].left);
+        right = t;
+    }
+    pull(t);
+}
+
+uint32_t RadiusIndex::merge(uint32_t left, uint32_t right)
+{
+    if (left == None) return right;
+    if (right == None) return left;
+    if (nodes[left].priority > nodes[right].priority)
+    {
+        nodes[left].right = merge(nodes[left].right, right);
+        pull(left);
+        return left;
+    }
+    nodes[right].left = merge(left, nodes[right].left);
+    pull(right);
+    return right;
+}
+
+uint32_t RadiusIndex::remove(uint32_t t, double radius, uint64_t id)
+{
+    Node& n = nodes[t];
+    if (n.id == id)
+        return merge(n.left, n.right);
+    if (less(t, radius, id))
+        n.right = remove(n.right, radius, id);
+    else
+        n.left = remove(n.left, radius, id);
+    pull(t);
+    return t;
+}
+
+void RadiusIndex::insert(uint64_t id, double radius)
+{
+    if (nodeOf.count(id))
+        throw std::invalid_argument("RadiusIndex::insert: curve is already indexed");
+
+    uint32_t t;
+    if (!freeNodes.empty())
+    {
+        t = freeNodes.back();
+        freeNodes.pop_back();
+    }
+    else
+    {
+        t = (uint32_t)nodes.size();
+        nodes.emplace_back();
+    }
+    nodes[t] = { radius, id, Priority(id), None, None, 1, radius };
+    nodeOf[id] = t;
+
+    uint32_t left, right;
+    split(root, radius, id, left, right);
+    root = merge(merge(left, t), right);
+}
+
+bool RadiusIndex::erase(uint64_t id)
+{
+    auto it = nodeOf.find(id);
+    if (it == nodeOf.end())
+        return false;
+
+    uint32_t t = it->second;
+    root = remove(root, nodes[t].radius, id);
+    freeNodes.push_back(t);
+    nodeOf.erase(it);
+    return true;
+}
+
+void RadiusIndex::clear()
+{
+    nodes.clear();
+    freeNodes.clear();
+    nodeOf.clear();
+    root = None;
+}
+
+RadiusIndex::Entry RadiusIndex::at(size_t rank) const
+{
+    if (rank >= size())
+        throw std::out_of_range("RadiusIndex::at: rank out of range");
+
+    uint32_t t = root;
+    while (true)
+    {
+        size_t leftCount = nodes[t].left == None ? 0 : nodes[nodes[t].left].count;
+        if (rank < leftCount)
+        {
+            t = nodes[t].left;
+        }
+        else if (rank == leftCount)
+        {
+            return { nodes[t].radius, nodes[t].id };
+        }
+        else
+        {
+            rank -= leftCount + 1;
+            t = nodes[t].right;
+        }
+    }
+}
+
+RadiusIndex::Range RadiusIndex::range(double minRadius, double maxRadius) const
+{
+    // Highest node inside the range; everything in it hangs below
+    uint32_t top = root;
+    while (top != None)
+    {
+        if (nodes[top].radius < minRadius)
+            top = nodes[top].right;
+        else if (nodes[top].radius > maxRadius)
+            top = nodes[top].left;
+        else
+            break;
+    }
+    if (top == None)
+        return { 0, 0.0 };
+
+    // Sums whole subtrees on the way down to each bound instead of taking the
+    // difference of two prefix sums, which would cancel for narrow ranges
+    Range result = { 1, nodes[top].radius };
+    auto add = [&](uint32_t t) {
+        if (t != None)
+        {
+            result.count += nodes[t].count;
+            result.sum += nodes[t].sum;
+        }
+    };
+
+    for (uint32_t t = nodes[top].left; t != None;)
+    {
+        if (nodes[t].radius >= minRadius)
+        {
+            result.count += 1;
+            result.sum += nodes[t].radius;
+            add(nodes[t].right);
+            t = nodes[t].left;
+        }
+        else
+        {
+            t = nodes[t].right;
+        }
+    }
+    for (uint32_t t = nodes[top].right; t != None;)
+    {
+        if (nodes[t].radius <= maxRadius)
+        {
+            result.count += 1;
+            result.sum += nodes[t].radius;
+            add(nodes[t].left);
+            t = nodes[t].right;
+        }
+        else
+        {
+            t = nodes[t].left;
+        }
+    }
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Circles ordered by radius, kept up to date one curve at a time instead of
+// being collected, sorted and summed again for every query. A treap keyed by
+// (radius, curve id) whose nodes also hold the count and radius sum of their
+// subtree, so order statistics and range sums are O(log n) expected.
+class RadiusIndex
+{
+public:
+    struct Entry
+    {
+        double radius;
+        uint64_t id;
+    };
+
+    struct Range
+    {
+        size_t count;
+        double sum;
+    };
+
+    // id is Curve3D::id(); throws std::invalid_argument if it is already indexed
+    void insert(uint64_t id, double radius);
+    // False if id was not indexed
+    bool erase(uint64_t id);
+    void clear();
+
+    bool contains(uint64_t id) const { return nodeOf.count(id) != 0; }
+    size_t size() const { return nodeOf.size(); }
+    double sum() const { return root == None ? 0.0 : nodes[root].sum; }
+
+    // rank-th smallest radius, equal radii ordered by id; throws std::out_of_range
+    Entry at(size_t rank) const;
+    // Circles with minRadius <= radius <= maxRadius
+    Range range(double minRadius, double maxRadius) const;
+
+    // Calls f(const Entry&) for every circle in radius order
+    template <class F>
+    void forEach(F&& f) const
+    {
+        std::vector<uint32_t> stack;
+        uint32_t t = root;
+        while (t != None || !stack.empty())
+        {
+            while (t != None)
+            {
+                stack.push_back(t);
+                t = nodes[t].left;
+            }
+            t = stack.back();
+            stack.pop_back();
+            f(Entry{ nodes[t].radius, nodes[t].id });
+            t = nodes[t].right;
+        }
+    }
+
+private:
+    static const uint32_t None = UINT32_MAX;
+
+    struct Node
+    {
+        double radius;
+        uint64_t id;
+        uint64_t priority;
+        uint32_t left;
+        uint32_t right;
+        uint32_t count;
+        double sum;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    std::unordered_map<uint64_t, uint32_t> nodeOf;
+    uint32_t root = None;
+
+    bool less(uint32_t t, double radius, uint64_t id) const;
+    void pull(uint32_t t);
+    // Splits t into keys below (radius, id) and the rest
+    void split(uint32_t t, double radius, uint64_t id, uint32_t& left, uint32_t& right);
+    uint32_t merge(uint32_t left, uint32_t right);
+    uint32_t remove(uint32_t t, double radius, uint64_t id);
+};
\ No newline at end of file
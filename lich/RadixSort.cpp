@@ -0,0 +1,194 @@
+#include "RadixSort.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    const int DigitBits = 11;
+    const size_t Buckets = size_t(1) << DigitBits;
+    const int Passes = (64 + DigitBits - 1) / DigitBits;
+    // Below this the fixed cost of the histograms outweighs the passes
+    const size_t RadixMinimum = 4096;
+
+    struct Histogram
+    {
+        size_t count[Passes][Buckets];
+    };
+
+    size_t Digit(uint64_t key, int pass)
+    {
+        return (size_t)(key >> (pass * DigitBits)) & (Buckets - 1);
+    }
+
+    // Sorts keys, carrying index along when it is not null. Both arrays are
+    // sorted in place; scratch space is allocated here.
+    void SortKeys(uint64_t* keys, uint32_t* index, size_t n, unsigned threads)
+    {
+        if (n < RadixMinimum)
+        {
+            std::vector<std::pair<uint64_t, uint32_t>> pairs(n);
+            for (size_t i = 0; i < n; ++i)
+                pairs[i] = { keys[i], index ? index[i] : 0 };
+            std::stable_sort(pairs.begin(), pairs.end(),
+                [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (size_t i = 0; i < n; ++i)
+            {
+                keys[i] = pairs[i].first;
+                if (index)
+                    index[i] = pairs[i].second;
+            }
+            return;
+        }
+
+        size_t blocks = std::max<size_t>(1, std::min<size_t>(ResolveThreadCount(threads), n / ParallelChunk));
+        auto blockBegin = [&](size_t b) { return n * b / blocks; };
+
+        // One read of the input counts the digits of every pass; a pass where
+        // one digit takes all keys would not move anything and is skipped
+        std::vector<Histogram> partial(blocks);
+        ParallelFor(blocks, (unsigned)blocks, 1, [&](size_t first, size_t last) {
+            for (size_t b = first; b < last; ++b)
+            {
+                Histogram& h = partial[b];
+                std::memset(&h, 0, sizeof(h));
+                for (size_t i = blockBegin(b); i < blockBegin(b + 1); ++i)
+                {
+                    for (int pass = 0; pass < Passes; ++pass)
+                        ++h.count[pass][Digit(keys[i], pass)];
+                }
+            }
+        });
+        std::vector<Histogram> total(1);
+        Histogram& h = total[0];
+        std::memset(&h, 0, sizeof(h));
+        for (const Histogram& p : partial)
+        {
+            for (int pass = 0; pass < Passes; ++pass)
+                for (size_t d = 0; d < Buckets; ++d)
+                    h.count[pass][d] += p.count[pass][d];
+        }
+
+        std::vector<uint64_t> keyScratch(n);
+        std::vector<uint32_t> indexScratch(index ? n : 0);
+        uint64_t* srcKeys = keys;
+        uint64_t* dstKeys = keyScratch.data();
+        uint32_t* srcIndex = index;
+        uint32_t* dstIndex = indexScratch.data();
+
+        // counts[b * Buckets + d]: keys of block b with digit d, then where they go
+        std::vector<size_t> counts(blocks * Buckets);
+        for (int pass = 0; pass < Passes; ++pass)
+        {
+            if (std::find(h.count[pass], h.count[pass] + Buckets, n) != h.count[pass] + Buckets)
+                continue;
+
+            // Keys have moved since the first read, so blocks recount this digit
+            if (blocks == 1)
+            {
+                std::copy(h.count[pass], h.count[pass] + Buckets, counts.begin());
+            }
+            else
+            {
+                ParallelFor(blocks, (unsigned)blocks, 1, [&](size_t first, size_t last) {
+                    for (size_t b = first; b < last; ++b)
+                    {
+                        size_t* count = &counts[b * Buckets];
+                        std::fill(count, count + Buckets, 0);
+                        for (size_t i = blockBegin(b); i < blockBegin(b + 1); ++i)
+                            ++count[Digit(srcKeys[i], pass)];
+                    }
+                });
+            }
+
+            // Digit-major, block-minor offsets keep equal digits in input order
+            size_t next = 0;
+            for (size_t d = 0; d < Buckets; ++d)
+            {
+                for (size_t b = 0; b < blocks; ++b)
+                {
+                    size_t count = counts[b * Buckets + d];
+                    counts[b * Buckets + d] = next;
+                    next += count;
+                }
+            }
+
+            ParallelFor(blocks, (unsigned)blocks, 1, [&](size_t first, size_t last) {
+                for (size_t b = first; b < last; ++b)
+                {
+                    size_t* offset = &counts[b * Buckets];
+                    for (size_t i = blockBegin(b); i < blockBegin(b + 1); ++i)
+                    {
+                        size_t to = offset[Digit(srcKeys[i], pass)]++;
+                        dstKeys[to] = srcKeys[i];
+                        if (srcIndex)
+                            dstIndex[to] = srcIndex[i];
+                    }
+                }
+            });
+            std::swap(srcKeys, dstKeys);
+            std::swap(srcIndex, dstIndex);
+        }
+
+        if (srcKeys != keys)
+        {
+            std::memcpy(keys, srcKeys, n * sizeof(uint64_t));
+            if (index)
+                std::memcpy(index, srcIndex, n * sizeof(uint32_t));
+        }
+    }
+
+    double FromOrderedBits(uint64_t bits)
+    {
+        bits = (bits >> 63) ? bits ^ 0x8000000000000000ull : ~bits;
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+uint64_t OrderedBits(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits ^ 0x8000000000000000ull;
+}
+
+std::vector<uint32_t> RadixSortOrder(std::span<const double> keys, unsigned threads)
+{
+    if (keys.size() > UINT32_MAX)
+        throw std::length_error("RadixSortOrder: more than UINT32_MAX keys");
+
+    size_t n = keys.size();
+    std::vector<uint64_t> bits(n);
+    std::vector<uint32_t> order(n);
+    ParallelFor(n, threads, ParallelChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            bits[i] = OrderedBits(keys[i]);
+            order[i] = (uint32_t)i;
+        }
+    });
+
+    SortKeys(bits.data(), order.data(), n, threads);
+    return order;
+}
+
+void RadixSort(std::span<double> values, unsigned threads)
+{
+    size_t n = values.size();
+    std::vector<uint64_t> bits(n);
+    ParallelFor(n, threads, ParallelChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            bits[i] = OrderedBits(values[i]);
+    });
+
+    SortKeys(bits.data(), nullptr, n, threads);
+
+    ParallelFor(n, threads, ParallelChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            values[i] = FromOrderedBits(bits[i]);
+    });
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Maps a double to an unsigned integer with the same order: the sign bit is
+// flipped for non-negative values, every bit for negative ones. -0.0 comes
+// just before +0.0 and NaNs go past the infinity of their sign.
+uint64_t OrderedBits(double value);
+
+// Stable LSD radix sort over OrderedBits: six passes of 11 bits, skipping
+// passes where every key has the same digit (radii in a narrow range share
+// the sign and exponent bits). Blocks of the input are histogrammed and
+// scattered on `threads` threads (0 = all); the result does not depend on it.
+// Inputs of a few thousand keys are merge sorted instead.
+
+// Permutation that sorts keys: keys[order[0]] <= keys[order[1]] <= ...
+// Equal keys keep their input order, as with std::stable_sort.
+// Throws std::length_error for more than UINT32_MAX keys.
+std::vector<uint32_t> RadixSortOrder(std::span<const double> keys, unsigned threads = 0);
+
+// Sorts values in place
+void RadixSort(std::span<double> values, unsigned threads = 0);
\ No newline at end of file
@@ -0,0 +1,416 @@
+#include "SceneFile.h"
+#include "AtomicFile.h"
+#include "Circle.h"
+#include "Ellipse.h"
+#include "Helix.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(Point3D) == 3 * sizeof(double), "Point3D columns are stored as packed x, y, z");
+static_assert(sizeof(SceneFileHeader) == 48, "SceneFileHeader layout is part of the file format");
+
+namespace
+{
+    const char SceneMagic[8] = { 'L', 'I', 'C', 'H', 'S', 'C', 'N', '\0' };
+
+    // Byte offsets of every section, in file order
+    struct SceneLayout
+    {
+        size_t kinds;
+        size_t position[3];
+        size_t rotation[3];
+        size_t parameters[3][3];
+        size_t total;
+    };
+
+    size_t AlignSection(size_t offset)
+    {
+        return (offset + 7) & ~size_t(7);
+    }
+
+    SceneLayout ComputeLayout(const SceneFileHeader& header)
+    {
+        SceneLayout layout{};
+        size_t offset = sizeof(SceneFileHeader);
+        auto section = [&](uint64_t size) {
+            size_t start = offset;
+            offset = AlignSection(offset + (size_t)size);
+            return start;
+        };
+
+        layout.kinds = section(header.curveCount);
+        for (int k = 0; k < 3; ++k)
+        {
+            uint64_t rows = header.rows[k];
+            layout.position[k] = section(rows * sizeof(Point3D));
+            layout.rotation[k] = section(rows * sizeof(Point3D));
+            switch ((CurveKind)k)
+            {
+            case CurveKind::Circle:
+                layout.parameters[k][0] = section(rows * sizeof(double));
+                break;
+            case CurveKind::Ellipse:
+                layout.parameters[k][0] = section(rows * sizeof(double));
+                layout.parameters[k][1] = section(rows * sizeof(double));
+                break;
+            case CurveKind::Helix:
+                layout.parameters[k][0] = section(rows * sizeof(double));
+                layout.parameters[k][1] = section(rows * sizeof(double));
+                layout.parameters[k][2] = section(rows * sizeof(int32_t));
+                break;
+            }
+        }
+        layout.total = offset;
+        return layout;
+    }
+
+    template <class T>
+    std::span<const T> MappedColumn(const std::byte* data, size_t offset, uint64_t count)
+    {
+        return std::span<const T>(reinterpret_cast<const T*>(data + offset), (size_t)count);
+    }
+
+    template <class T, class... Args>
+    std::shared_ptr<Curve3D> MakeCurve(CurveArena* arena, Args... args)
+    {
+        if (arena)
+            return arena->make<T>(args...);
+        return std::make_shared<T>(args...);
+    }
+
+    void CheckByteOrder()
+    {
+        if constexpr (std::endian::native != std::endian::little)
+            throw std::runtime_error("scene files are only supported on little-endian machines");
+    }
+
+    // fwrite through a large buffer; sections are padded as ComputeLayout
+    // expects. The scene goes to a temporary file that replaces the target
+    // in close(), so a failed save keeps the previous scene.
+    class SceneWriter
+    {
+    public:
+        explicit SceneWriter(const std::string& path) : file(path), buffer(size_t(1) << 20) {}
+
+        void write(const void* data, size_t size)
+        {
+            const char* bytes = static_cast<const char*>(data);
+            while (size > 0)
+            {
+                size_t n = std::min(size, buffer.size() - used);
+                std::memcpy(buffer.data() + used, bytes, n);
+                used += n;
+                bytes += n;
+                size -= n;
+                if (used == buffer.size())
+                    flush();
+            }
+        }
+
+        template <class T>
+        void write(const T& value)
+        {
+            write(&value, sizeof(T));
+        }
+
+        void endSection()
+        {
+            static const char zeros[8] = {};
+            write(zeros, AlignSection(offset()) - offset());
+        }
+
+        void close()
+        {
+            flush();
+            file.commit();
+        }
+
+    private:
+        AtomicFile file;
+        std::vector<char> buffer;
+        size_t used = 0;
+        size_t written = 0;
+
+        size_t offset() const { return written + used; }
+
+        void flush()
+        {
+            if (used > 0 && std::fwrite(buffer.data(), 1, used, file.get()) != used)
+                throw std::runtime_error("cannot write " + file.path());
+            written += used;
+            used = 0;
+        }
+    };
+}
+
+MappedScene::MappedScene(const std::string& path)
+{
+    CheckByteOrder();
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file = nullptr;
+        throw std::runtime_error("cannot open " + path);
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        unmap();
+        throw std::runtime_error("cannot read " + path);
+    }
+    bytes = (size_t)size.QuadPart;
+    if (bytes > 0)
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        data = mapping ? static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+        if (!data)
+        {
+            unmap();
+            throw std::runtime_error("cannot map " + path);
+        }
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("cannot open " + path);
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("cannot read " + path);
+    }
+    bytes = (size_t)info.st_size;
+    if (bytes > 0)
+    {
+        void* view = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("cannot map " + path);
+        }
+        data = static_cast<const std::byte*>(view);
+    }
+    // The mapping keeps the file alive on its own
+    ::close(fd);
+#endif
+
+    SceneFileHeader header;
+    if (bytes < sizeof(header))
+    {
+        unmap();
+        throw std::runtime_error(path + " is not a scene file");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, SceneMagic, sizeof(SceneMagic)) != 0 || header.headerSize != sizeof(header))
+    {
+        unmap();
+        throw std::runtime_error(path + " is not a scene file");
+    }
+    if (header.version != SceneFileVersion)
+    {
+        unmap();
+        throw std::runtime_error(path + " has unsupported scene version " + std::to_string(header.version));
+    }
+    // Row indices are 32-bit in CurveSet; this also keeps the layout arithmetic from overflowing
+    bool countsValid = header.curveCount <= UINT32_MAX
+        && header.rows[0] <= header.curveCount && header.rows[1] <= header.curveCount && header.rows[2] <= header.curveCount
+        && header.rows[0] + header.rows[1] + header.rows[2] == header.curveCount;
+    if (!countsValid || ComputeLayout(header).total > bytes)
+    {
+        unmap();
+        throw std::runtime_error(path + " is truncated or corrupt");
+    }
+
+    SceneLayout layout = ComputeLayout(header);
+    const int circle = (int)CurveKind::Circle, ellipse = (int)CurveKind::Ellipse, helix = (int)CurveKind::Helix;
+
+    curveKinds = MappedColumn<uint8_t>(data, layout.kinds, header.curveCount);
+
+    auto common = [&](Columns& columns, int k) {
+        columns.position = MappedColumn<Point3D>(data, layout.position[k], header.rows[k]);
+        columns.rotation = MappedColumn<Point3D>(data, layout.rotation[k], header.rows[k]);
+    };
+    common(circleColumns, circle);
+    circleColumns.radius = MappedColumn<double>(data, layout.parameters[circle][0], header.rows[circle]);
+    common(ellipseColumns, ellipse);
+    ellipseColumns.a = MappedColumn<double>(data, layout.parameters[ellipse][0], header.rows[ellipse]);
+    ellipseColumns.b = MappedColumn<double>(data, layout.parameters[ellipse][1], header.rows[ellipse]);
+    common(helixColumns, helix);
+    helixColumns.radius = MappedColumn<double>(data, layout.parameters[helix][0], header.rows[helix]);
+    helixColumns.step = MappedColumn<double>(data, layout.parameters[helix][1], header.rows[helix]);
+    helixColumns.turns = MappedColumn<int32_t>(data, layout.parameters[helix][2], header.rows[helix]);
+}
+
+MappedScene::~MappedScene()
+{
+    unmap();
+}
+
+void MappedScene::unmap()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (data)
+        ::munmap(const_cast<std::byte*>(data), bytes);
+#endif
+    data = nullptr;
+    bytes = 0;
+}
+
+void MappedScene::validateKinds() const
+{
+    std::array<size_t, 3> counts{};
+    for (uint8_t kind : curveKinds)
+    {
+        if (kind > (uint8_t)CurveKind::Helix)
+            throw std::runtime_error("scene file has an unknown curve kind " + std::to_string(kind));
+        ++counts[kind];
+    }
+    if (counts[0] != circleColumns.radius.size() || counts[1] != ellipseColumns.a.size() || counts[2] != helixColumns.radius.size())
+        throw std::runtime_error("scene file kinds do not match its row counts");
+}
+
+void MappedScene::load(CurveSet& curves, unsigned threads) const
+{
+    validateKinds();
+    curves.assign(std::span<const CurveKind>(reinterpret_cast<const CurveKind*>(curveKinds.data()), curveKinds.size()));
+
+    // Rows were handed out in scene order, the order they are stored in
+    auto copyCommon = [&](CurveSet::Columns& to, const Columns& from) {
+        std::copy(from.position.begin(), from.position.end(), to.position.begin());
+        std::copy(from.rotation.begin(), from.rotation.end(), to.rotation.begin());
+        ParallelFor(from.position.size(), threads, ParallelChunk, [&](size_t begin, size_t end) {
+            for (size_t r = begin; r < end; ++r)
+                to.transform[r] = Transform3D(from.position[r], from.rotation[r]);
+        });
+    };
+
+    CurveSet::CircleColumns& circles = curves.writableCircles();
+    copyCommon(circles, circleColumns);
+    std::copy(circleColumns.radius.begin(), circleColumns.radius.end(), circles.radius.begin());
+
+    CurveSet::EllipseColumns& ellipses = curves.writableEllipses();
+    copyCommon(ellipses, ellipseColumns);
+    std::copy(ellipseColumns.a.begin(), ellipseColumns.a.end(), ellipses.a.begin());
+    std::copy(ellipseColumns.b.begin(), ellipseColumns.b.end(), ellipses.b.begin());
+
+    CurveSet::HelixColumns& helices = curves.writableHelices();
+    copyCommon(helices, helixColumns);
+    std::copy(helixColumns.radius.begin(), helixColumns.radius.end(), helices.radius.begin());
+    std::copy(helixColumns.step.begin(), helixColumns.step.end(), helices.step.begin());
+    std::copy(helixColumns.turns.begin(), helixColumns.turns.end(), helices.turns.begin());
+}
+
+void MappedScene::load(std::vector<std::shared_ptr<Curve3D>>& curves, CurveArena* arena) const
+{
+    validateKinds();
+    curves.clear();
+    curves.reserve(curveKinds.size());
+
+    std::array<size_t, 3> rows{};
+    for (uint8_t kind : curveKinds)
+    {
+        size_t r = rows[kind]++;
+        std::shared_ptr<Curve3D> curve;
+        const Columns* columns = nullptr;
+        switch ((CurveKind)kind)
+        {
+        case CurveKind::Circle:
+            curve = MakeCurve<Circle3D>(arena, circleColumns.radius[r]);
+            columns = &circleColumns;
+            break;
+        case CurveKind::Ellipse:
+            curve = MakeCurve<Ellipse3D>(arena, ellipseColumns.a[r], ellipseColumns.b[r]);
+            columns = &ellipseColumns;
+            break;
+        case CurveKind::Helix:
+            curve = MakeCurve<Helix3D>(arena, helixColumns.radius[r], helixColumns.step[r], (int)helixColumns.turns[r]);
+            columns = &helixColumns;
+            break;
+        }
+        curve->setPosition(columns->position[r]);
+        curve->setRotation(columns->rotation[r]);
+        curves.push_back(std::move(curve));
+    }
+}
+
+void SaveScene(const std::string& path, const CurveSet& curves)
+{
+    CheckByteOrder();
+
+    // Rows of each kind in handle order; after remove() that differs from column order
+    std::vector<CurveHandle> handles = curves.handles();
+    std::array<std::vector<uint32_t>, 3> order;
+    for (CurveHandle handle : handles)
+        order[(int)curves.kind(handle)].push_back((uint32_t)curves.row(handle));
+
+    SceneFileHeader header{};
+    std::memcpy(header.magic, SceneMagic, sizeof(SceneMagic));
+    header.version = SceneFileVersion;
+    header.headerSize = sizeof(header);
+    header.curveCount = handles.size();
+    for (int k = 0; k < 3; ++k)
+        header.rows[k] = order[k].size();
+
+    SceneWriter file(path);
+    file.write(header);
+    for (CurveHandle handle : handles)
+        file.write((uint8_t)curves.kind(handle));
+    file.endSection();
+
+    auto column = [&](int k, auto&& values) {
+        for (uint32_t r : order[k])
+            file.write(values[r]);
+        file.endSection();
+    };
+    auto common = [&](int k, const CurveSet::Columns& columns) {
+        column(k, columns.position);
+        column(k, columns.rotation);
+    };
+
+    const int circle = (int)CurveKind::Circle, ellipse = (int)CurveKind::Ellipse, helix = (int)CurveKind::Helix;
+    common(circle, curves.circles());
+    column(circle, curves.circles().radius);
+    common(ellipse, curves.ellipses());
+    column(ellipse, curves.ellipses().a);
+    column(ellipse, curves.ellipses().b);
+    common(helix, curves.helices());
+    column(helix, curves.helices().radius);
+    column(helix, curves.helices().step);
+    for (uint32_t r : order[helix])
+        file.write((int32_t)curves.helices().turns[r]);
+    file.endSection();
+
+    file.close();
+}
+
+void SaveScene(const std::string& path, const std::vector<std::shared_ptr<Curve3D>>& curves)
+{
+    SaveScene(path, CurveSet::FromCurves(curves));
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+#include "Curve3D.h"
+#include "CurveArena.h"
+#include "CurveSet.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// Binary scene file. Everything is little-endian and every section starts at
+// a multiple of 8 bytes, so a mapped file is used in place:
+//
+//   SceneFileHeader
+//   kinds       uint8[curveCount]   CurveKind of every curve, in scene order
+//   then for circles, ellipses and helices, rows in scene order:
+//     position  double[3 * rows]    x, y, z
+//     rotation  double[3 * rows]
+//     circle    radius double[rows]
+//     ellipse   a double[rows], b double[rows]
+//     helix     radius double[rows], step double[rows], turns int32[rows]
+struct SceneFileHeader
+{
+    char magic[8];    // "LICHSCN\0"
+    uint32_t version; // SceneFileVersion
+    uint32_t headerSize;
+    uint64_t curveCount;
+    uint64_t rows[3]; // curves of each CurveKind
+};
+
+const uint32_t SceneFileVersion = 1;
+
+// Read-only view of a mapped scene file. Opening checks the header against
+// the file size and touches nothing else, so it takes the same time for any
+// scene; columns are paged in by the OS when first read.
+class MappedScene
+{
+public:
+    struct Columns
+    {
+        std::span<const Point3D> position;
+        std::span<const Point3D> rotation;
+    };
+
+    struct CircleColumns : Columns
+    {
+        std::span<const double> radius;
+    };
+
+    struct EllipseColumns : Columns
+    {
+        std::span<const double> a;
+        std::span<const double> b;
+    };
+
+    struct HelixColumns : Columns
+    {
+        std::span<const double> radius;
+        std::span<const double> step;
+        std::span<const int32_t> turns;
+    };
+
+    // Throws std::runtime_error if the file cannot be read or is not a valid scene
+    explicit MappedScene(const std::string& path);
+    MappedScene(const MappedScene&) = delete;
+    MappedScene& operator=(const MappedScene&) = delete;
+    ~MappedScene();
+
+    size_t size() const { return curveKinds.size(); }
+    // Not validated until a load(); may hold out-of-range values in a corrupt file
+    std::span<const uint8_t> kinds() const { return curveKinds; }
+    const CircleColumns& circles() const { return circleColumns; }
+    const EllipseColumns& ellipses() const { return ellipseColumns; }
+    const HelixColumns& helices() const { return helixColumns; }
+
+    // Replace the contents of curves with the scene. Throw std::runtime_error
+    // if the kinds do not match the row counts of the header.
+    void load(CurveSet& curves, unsigned threads = 0) const;
+    void load(std::vector<std::shared_ptr<Curve3D>>& curves, CurveArena* arena = nullptr) const;
+
+private:
+    const std::byte* data = nullptr;
+    size_t bytes = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+
+    std::span<const uint8_t> curveKinds;
+    CircleColumns circleColumns;
+    EllipseColumns ellipseColumns;
+    HelixColumns helixColumns;
+
+    void unmap();
+    void validateKinds() const;
+};
+
+// Write curves in scene (handle) order. Throw std::runtime_error on I/O errors.
+// The file is written as path + ".tmp" and renamed over path when complete;
+// after a failure an existing file at path is left unchanged.
+void SaveScene(const std::string& path, const CurveSet& curves);
+void SaveScene(const std::string& path, const std::vector<std::shared_ptr<Curve3D>>& curves);
\ No newline at end of file
@@ -0,0 +1,557 @@
+#include "SceneText.h"
+#include "Circle.h"
+#include "Ellipse.h"
+#include "Helix.h"
+#include "OutputWriter.h"
+#include "Parallel.h"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+namespace
+{
+    // Bytes read per block; each block is split between the parsing threads.
+    // Blocks start small and double, so short files are not charged for a big buffer.
+    const size_t FirstBlockSize = size_t(64) << 10;
+    const size_t BlockSize = size_t(16) << 20;
+    // Smaller blocks are not worth another thread
+    const size_t MinBytesPerThread = size_t(1) << 20;
+
+    struct CurveRecord
+    {
+        CurveKind kind;
+        Point3D position;
+        Point3D rotation;
+        double parameters[2]; // radius or a; b or step
+        int turns;
+    };
+
+    // Thrown inside a line parser and turned into a SceneParseError with the line number
+    struct LineError
+    {
+        std::string message;
+    };
+
+    int ParameterCount(CurveKind kind)
+    {
+        switch (kind)
+        {
+        case CurveKind::Circle: return 1;
+        case CurveKind::Ellipse: return 2;
+        default: return 3;
+        }
+    }
+
+    std::string_view Trim(std::string_view text)
+    {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+            text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    CurveKind ParseKind(std::string_view text)
+    {
+        for (CurveKind kind : { CurveKind::Circle, CurveKind::Ellipse, CurveKind::Helix })
+        {
+            if (text == CurveKindName(kind))
+                return kind;
+        }
+        throw LineError{ "unknown curve kind '" + std::string(text) + "'" };
+    }
+
+    double ParseNumber(std::string_view text, const char* field)
+    {
+        double value = 0.0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size() || !std::isfinite(value))
+            throw LineError{ std::string("bad number for ") + field + ": '" + std::string(text) + "'" };
+        return value;
+    }
+
+    int ParseInteger(std::string_view text, const char* field)
+    {
+        int value = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size())
+            throw LineError{ std::string("bad integer for ") + field + ": '" + std::string(text) + "'" };
+        return value;
+    }
+
+    // Returns false for lines without a curve
+    bool ParseCsvLine(std::string_view line, CurveRecord& record)
+    {
+        static const char* const Fields[] = { "kind", "x", "y", "z", "rx", "ry", "rz", "p1", "p2", "p3" };
+        const size_t MaxFields = std::size(Fields);
+
+        line = Trim(line);
+        if (line.empty() || line.starts_with("kind"))
+            return false;
+
+        std::array<std::string_view, MaxFields> fields;
+        size_t count = 0;
+        size_t start = 0;
+        while (true)
+        {
+            size_t comma = line.find(',', start);
+            std::string_view field = Trim(line.substr(start, comma == std::string_view::npos ? std::string_view::npos : comma - start));
+            if (count < MaxFields)
+                fields[count++] = field;
+            else if (!field.empty())
+                throw LineError{ "too many fields" };
+            if (comma == std::string_view::npos)
+                break;
+            start = comma + 1;
+        }
+
+        record.kind = ParseKind(fields[0]);
+        size_t used = 7 + ParameterCount(record.kind);
+        if (count < used)
+            throw LineError{ std::string(CurveKindName(record.kind)) + " needs " + std::to_string(used) + " fields, got " + std::to_string(count) };
+        for (size_t i = used; i < count; ++i)
+        {
+            if (!fields[i].empty())
+                throw LineError{ std::string("unexpected value in ") + Fields[i] + " for " + CurveKindName(record.kind) };
+        }
+
+        record.position = Point3D(ParseNumber(fields[1], Fields[1]), ParseNumber(fields[2], Fields[2]), ParseNumber(fields[3], Fields[3]));
+        record.rotation = Point3D(ParseNumber(fields[4], Fields[4]), ParseNumber(fields[5], Fields[5]), ParseNumber(fields[6], Fields[6]));
+        record.parameters[0] = ParseNumber(fields[7], Fields[7]);
+        record.parameters[1] = used > 8 ? ParseNumber(fields[8], Fields[8]) : 0.0;
+        record.turns = used > 9 ? ParseInteger(fields[9], Fields[9]) : 0;
+        return true;
+    }
+
+    // Just enough JSON for flat objects of strings, numbers and number triples
+    class JsonCursor
+    {
+    public:
+        explicit JsonCursor(std::string_view text) : text(text) {}
+
+        bool done()
+        {
+            skipSpace();
+            return at == text.size();
+        }
+
+        bool consume(char c)
+        {
+            skipSpace();
+            if (at < text.size() && text[at] == c)
+            {
+                ++at;
+                return true;
+            }
+            return false;
+        }
+
+        void expect(char c)
+        {
+            if (!consume(c))
+                throw LineError{ std::string("expected '") + c + "' at column " + std::to_string(at + 1) };
+        }
+
+        std::string_view string()
+        {
+            expect('"');
+            size_t end = text.find_first_of("\"\\", at);
+            if (end == std::string_view::npos || text[end] != '"')
+                throw LineError{ "unterminated or escaped string at column " + std::to_string(at + 1) };
+            std::string_view value = text.substr(at, end - at);
+            at = end + 1;
+            return value;
+        }
+
+        // The characters of a number, left for from_chars to check
+        std::string_view number()
+        {
+            skipSpace();
+            size_t end = text.find_first_not_of("+-.0123456789eE", at);
+            if (end == std::string_view::npos)
+                end = text.size();
+            std::string_view value = text.substr(at, end - at);
+            at = end;
+            return value;
+        }
+
+        Point3D point(const char* field)
+        {
+            expect('[');
+            double x = ParseNumber(number(), field);
+            expect(',');
+            double y = ParseNumber(number(), field);
+            expect(',');
+            double z = ParseNumber(number(), field);
+            expect(']');
+            return Point3D(x, y, z);
+        }
+
+    private:
+        std::string_view text;
+        size_t at = 0;
+
+        void skipSpace()
+        {
+            while (at < text.size() && (text[at] == ' ' || text[at] == '\t' || text[at] == '\r'))
+                ++at;
+        }
+    };
+
+    bool ParseJsonLine(std::string_view line, CurveRecord& record)
+    {
+        JsonCursor in(line);
+        if (in.done())
+            return false;
+
+        bool hasKind = false;
+        bool has[3] = {}; // parameters[0], parameters[1], turns
+        bool isEllipseAxis[2] = {};
+        record.position = Point3D();
+        record.rotation = Point3D();
+
+        in.expect('{');
+        if (!in.consume('}'))
+        {
+            do
+            {
+                std::string_view key = in.string();
+                in.expect(':');
+                if (key == "kind")
+                {
+                    record.kind = ParseKind(in.string());
+                    hasKind = true;
+                }
+                else if (key == "position")
+                    record.position = in.point("position");
+                else if (key == "rotation")
+                    record.rotation = in.point("rotation");
+                else if (key == "radius" || key == "a")
+                {
+                    record.parameters[0] = ParseNumber(in.number(), key == "a" ? "a" : "radius");
+                    isEllipseAxis[0] = key == "a";
+                    has[0] = true;
+                }
+                else if (key == "b" || key == "step")
+                {
+                    record.parameters[1] = ParseNumber(in.number(), key == "b" ? "b" : "step");
+                    isEllipseAxis[1] = key == "b";
+                    has[1] = true;
+                }
+                else if (key == "turns")
+                {
+                    record.turns = ParseInteger(in.number(), "turns");
+                    has[2] = true;
+                }
+                else
+                    throw LineError{ "unknown key \"" + std::string(key) + "\"" };
+            } while (in.consume(','));
+            in.expect('}');
+        }
+        if (!in.done())
+            throw LineError{ "unexpected text after the object" };
+
+        if (!hasKind)
+            throw LineError{ "missing \"kind\"" };
+        int count = ParameterCount(record.kind);
+        bool ellipse = record.kind == CurveKind::Ellipse;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (has[i] != (i < count) || (i < 2 && has[i] && isEllipseAxis[i] != ellipse))
+            {
+                switch (record.kind)
+                {
+                case CurveKind::Circle: throw LineError{ "a Circle takes exactly \"radius\"" };
+                case CurveKind::Ellipse: throw LineError{ "an Ellipse takes exactly \"a\" and \"b\"" };
+                case CurveKind::Helix: throw LineError{ "a Helix takes exactly \"radius\", \"step\" and \"turns\"" };
+                }
+            }
+        }
+        if (record.kind != CurveKind::Helix)
+            record.turns = 0;
+        if (count < 2)
+            record.parameters[1] = 0.0;
+        return true;
+    }
+
+    // Curves of one range of lines, or the first error in it
+    struct RangeResult
+    {
+        std::vector<CurveRecord> records;
+        size_t lines = 0;
+        bool failed = false;
+        std::string message;
+    };
+
+    void ParseRange(std::string_view text, SceneTextFormat format, RangeResult& result)
+    {
+        result.records.clear();
+        result.lines = 0;
+        result.failed = false;
+        while (!text.empty())
+        {
+            size_t newline = text.find('\n');
+            std::string_view line = text.substr(0, newline);
+            text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+            ++result.lines;
+
+            try
+            {
+                CurveRecord record;
+                bool parsed = format == SceneTextFormat::Csv ? ParseCsvLine(line, record) : ParseJsonLine(line, record);
+                if (parsed)
+                    result.records.push_back(record);
+            }
+            catch (const LineError& error)
+            {
+                result.failed = true;
+                result.message = error.message;
+                return;
+            }
+        }
+    }
+
+    // Hands the records of the file to sink in file order, one block at a time
+    template <class Sink>
+    void ParseSceneText(const std::string& path, SceneTextFormat format, unsigned threads, Sink&& sink)
+    {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file)
+            throw SceneParseError(path, 0, "cannot open file");
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> closer(file, std::fclose);
+
+        std::vector<char> block;
+        std::vector<RangeResult> ranges;
+        size_t carried = 0; // unfinished last line of the previous block
+        size_t firstLine = 1;
+        size_t blockSize = FirstBlockSize;
+        while (true)
+        {
+            block.resize(carried + blockSize);
+            size_t got = std::fread(block.data() + carried, 1, blockSize, file);
+            if (std::ferror(file))
+                throw SceneParseError(path, 0, "read error");
+            size_t size = carried + got;
+            bool last = got < blockSize;
+            blockSize = std::min(blockSize * 2, BlockSize);
+
+            // Parse whole lines only; the rest is carried into the next block
+            size_t end = size;
+            if (!last)
+            {
+                const char* newline = nullptr;
+                for (size_t i = size; i > 0 && !newline; --i)
+                {
+                    if (block[i - 1] == '\n')
+                        newline = block.data() + i - 1;
+                }
+                if (!newline)
+                {
+                    // One line longer than the block: read more before parsing
+                    carried = size;
+                    continue;
+                }
+                end = newline - block.data() + 1;
+            }
+
+            // Split at line starts into one range per thread
+            size_t workers = std::max<size_t>(1, std::min<size_t>(ResolveThreadCount(threads), end / MinBytesPerThread));
+            std::vector<size_t> bounds(workers + 1, end);
+            bounds[0] = 0;
+            for (size_t w = 1; w < workers; ++w)
+            {
+                size_t from = std::max(bounds[w - 1], end * w / workers);
+                const void* newline = from < end ? std::memchr(block.data() + from, '\n', end - from) : nullptr;
+                bounds[w] = newline ? static_cast<const char*>(newline) - block.data() + 1 : end;
+            }
+
+            ranges.resize(workers);
+            ParallelFor(workers, threads, 1, [&](size_t first, size_t lastRange) {
+                for (size_t w = first; w < lastRange; ++w)
+                    ParseRange(std::string_view(block.data() + bounds[w], bounds[w + 1] - bounds[w]), format, ranges[w]);
+            });
+
+            for (const RangeResult& range : ranges)
+            {
+                if (range.failed)
+                    throw SceneParseError(path, firstLine + range.lines - 1, range.message);
+                sink(range.records);
+                firstLine += range.lines;
+            }
+
+            if (last)
+                break;
+            carried = size - end;
+            std::memmove(block.data(), block.data() + end, carried);
+        }
+    }
+
+    void WriteRecord(OutputWriter& out, SceneTextFormat format, const CurveRecord& record)
+    {
+        int count = ParameterCount(record.kind);
+        if (format == SceneTextFormat::Csv)
+        {
+            out << CurveKindName(record.kind) << ',' << record.position << ',' << record.rotation << ',' << record.parameters[0] << ',';
+            if (count > 1)
+                out << record.parameters[1];
+            out << ',';
+            if (count > 2)
+                out << record.turns;
+            out << '\n';
+            return;
+        }
+
+        out << "{\"kind\":\"" << CurveKindName(record.kind) << "\",\"position\":[" << record.position
+            << "],\"rotation\":[" << record.rotation << "],";
+        switch (record.kind)
+        {
+        case CurveKind::Circle:
+            out << "\"radius\":" << record.parameters[0];
+            break;
+        case CurveKind::Ellipse:
+            out << "\"a\":" << record.parameters[0] << ",\"b\":" << record.parameters[1];
+            break;
+        case CurveKind::Helix:
+            out << "\"radius\":" << record.parameters[0] << ",\"step\":" << record.parameters[1] << ",\"turns\":" << record.turns;
+            break;
+        }
+        out << "}\n";
+    }
+}
+
+namespace
+{
+    // "path:line: message", or "path: message" without a line
+    std::string ParseErrorMessage(const std::string& path, size_t line, const std::string& message)
+    {
+        std::string text = path;
+        if (line)
+        {
+            text += ':';
+            text += std::to_string(line);
+        }
+        text += ": ";
+        text += message;
+        return text;
+    }
+}
+
+SceneParseError::SceneParseError(const std::string& path, size_t line, const std::string& message)
+    : std::runtime_error(ParseErrorMessage(path, line, message)), errorLine(line) {
+}
+
+void ImportSceneText(const std::string& path, SceneTextFormat format, CurveSet& curves, unsigned threads)
+{
+    // Gathered per kind and loaded in bulk, as Task1 does: adding curves one
+    // by one would cost more than parsing them
+    std::vector<CurveKind> kinds;
+    std::array<std::vector<CurveRecord>, 3> byKind;
+    ParseSceneText(path, format, threads, [&](const std::vector<CurveRecord>& records) {
+        for (const CurveRecord& r : records)
+        {
+            kinds.push_back(r.kind);
+            byKind[(int)r.kind].push_back(r);
+        }
+    });
+
+    CurveSet loaded;
+    loaded.assign(kinds);
+    auto fill = [&](CurveSet::Columns& columns, CurveKind kind, auto&& parameters) {
+        const std::vector<CurveRecord>& records = byKind[(int)kind];
+        ParallelFor(records.size(), threads, ParallelChunk, [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; ++row)
+            {
+                const CurveRecord& r = records[row];
+                columns.position[row] = r.position;
+                columns.rotation[row] = r.rotation;
+                columns.transform[row] = Transform3D(r.position, r.rotation);
+                parameters(row, r);
+            }
+        });
+    };
+    CurveSet::CircleColumns& circles = loaded.writableCircles();
+    fill(circles, CurveKind::Circle, [&](size_t row, const CurveRecord& r) {
+        circles.radius[row] = r.parameters[0];
+    });
+    CurveSet::EllipseColumns& ellipses = loaded.writableEllipses();
+    fill(ellipses, CurveKind::Ellipse, [&](size_t row, const CurveRecord& r) {
+        ellipses.a[row] = r.parameters[0];
+        ellipses.b[row] = r.parameters[1];
+    });
+    CurveSet::HelixColumns& helices = loaded.writableHelices();
+    fill(helices, CurveKind::Helix, [&](size_t row, const CurveRecord& r) {
+        helices.radius[row] = r.parameters[0];
+        helices.step[row] = r.parameters[1];
+        helices.turns[row] = r.turns;
+    });
+    curves = std::move(loaded);
+}
+
+void ImportSceneText(const std::string& path, SceneTextFormat format, std::vector<std::shared_ptr<Curve3D>>& curves,
+    CurveArena* arena, unsigned threads)
+{
+    std::vector<std::shared_ptr<Curve3D>> loaded;
+    ParseSceneText(path, format, threads, [&](const std::vector<CurveRecord>& records) {
+        for (const CurveRecord& r : records)
+        {
+            std::shared_ptr<Curve3D> curve;
+            switch (r.kind)
+            {
+            case CurveKind::Circle:
+                curve = arena ? arena->make<Circle3D>(r.parameters[0]) : std::make_shared<Circle3D>(r.parameters[0]);
+                break;
+            case CurveKind::Ellipse:
+                curve = arena ? arena->make<Ellipse3D>(r.parameters[0], r.parameters[1])
+                              : std::make_shared<Ellipse3D>(r.parameters[0], r.parameters[1]);
+                break;
+            case CurveKind::Helix:
+                curve = arena ? arena->make<Helix3D>(r.parameters[0], r.parameters[1], r.turns)
+                              : std::make_shared<Helix3D>(r.parameters[0], r.parameters[1], r.turns);
+                break;
+            }
+            curve->setPosition(r.position);
+            curve->setRotation(r.rotation);
+            loaded.push_back(std::move(curve));
+        }
+    });
+    curves.swap(loaded);
+}
+
+void ExportSceneText(const std::string& path, SceneTextFormat format, const CurveSet& curves)
+{
+    // OutputWriter's CSV mode writes shortest round-trip numbers, which JSON accepts too
+    OutputWriter out(path, OutputFormat::Csv);
+    if (format == SceneTextFormat::Csv)
+        out << "kind,x,y,z,rx,ry,rz,p1,p2,p3\n";
+
+    for (CurveHandle handle : curves.handles())
+    {
+        CurveRecord record{ curves.kind(handle), curves.getPosition(handle), curves.getRotation(handle), { 0.0, 0.0 }, 0 };
+        size_t row = curves.row(handle);
+        switch (record.kind)
+        {
+        case CurveKind::Circle:
+            record.parameters[0] = curves.circles().radius[row];
+            break;
+        case CurveKind::Ellipse:
+            record.parameters[0] = curves.ellipses().a[row];
+            record.parameters[1] = curves.ellipses().b[row];
+            break;
+        case CurveKind::Helix:
+            record.parameters[0] = curves.helices().radius[row];
+            record.parameters[1] = curves.helices().step[row];
+            record.turns = curves.helices().turns[row];
+            break;
+        }
+        WriteRecord(out, format, record);
+    }
+    out.close();
+}
+
+void ExportSceneText(const std::string& path, SceneTextFormat format, const std::vector<std::shared_ptr<Curve3D>>& curves)
+{
+    ExportSceneText(path, format, CurveSet::FromCurves(curves));
+}
\ No newline at end of file
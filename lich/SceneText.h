@@ -0,0 +1,50 @@
+#pragma once
+#include "Curve3D.h"
+#include "CurveArena.h"
+#include "CurveSet.h"
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Text scene formats for exchange with other tools, one curve per line.
+//
+// Csv: kind,x,y,z,rx,ry,rz,p1,p2,p3 with an optional header line starting
+// with "kind". p1..p3 are radius for a circle, a,b for an ellipse and
+// radius,step,turns for a helix; unused trailing fields may be empty or left out.
+//
+// JsonLines: one object per line, keys in any order, for example
+//   {"kind":"Helix","position":[0,0,0],"rotation":[0,0,0],"radius":1,"step":0.5,"turns":3}
+// with "radius" for circles and "a", "b" for ellipses.
+//
+// Blank lines are skipped in both. Kinds are the CurveKindName() spellings.
+enum class SceneTextFormat
+{
+    Csv,
+    JsonLines
+};
+
+// Import error with the 1-based line it was found on (0 if not tied to a line)
+class SceneParseError : public std::runtime_error
+{
+public:
+    SceneParseError(const std::string& path, size_t line, const std::string& message);
+
+    size_t line() const { return errorLine; }
+
+private:
+    size_t errorLine;
+};
+
+// Reads the file in large blocks and parses each block on `threads` threads
+// (0 = all). curves is replaced only if the whole file parses; otherwise
+// SceneParseError reports the first bad line.
+void ImportSceneText(const std::string& path, SceneTextFormat format, CurveSet& curves, unsigned threads = 0);
+void ImportSceneText(const std::string& path, SceneTextFormat format, std::vector<std::shared_ptr<Curve3D>>& curves,
+    CurveArena* arena = nullptr, unsigned threads = 0);
+
+// Numbers are written in the shortest form that reads back to the same double.
+// Throw std::runtime_error on I/O errors.
+void ExportSceneText(const std::string& path, SceneTextFormat format, const CurveSet& curves);
+void ExportSceneText(const std::string& path, SceneTextFormat format, const std::vector<std::shared_ptr<Curve3D>>& curves);
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "SinCos.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || (defined(__i386__) && defined(__SSE2__))
+#define LICH_SINCOS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LICH_TARGET_AVX2
+#else
+#define LICH_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace
+{
+    // 2/pi and pi/2 split into three 33-bit pieces (fdlibm), so q * PiO2_1
+    // is exact for |q| < 2^20
+    const double TwoOverPi = 6.36619772367581382433e-01;
+    const double PiO2_1 = 1.57079632673412561417e+00;
+    const double PiO2_2 = 6.07710050630396597660e-11;
+    const double PiO2_3 = 2.02226624871116645580e-21;
+
+    // Adding 1.5 * 2^52 rounds to the nearest integer and leaves it in the low mantissa bits
+    const double RoundMagic = 6755399441055744.0;
+
+    // fdlibm __kernel_sin / __kernel_cos coefficients for |r| <= pi/4
+    const double S1 = -1.66666666666666324348e-01;
+    const double S2 = 8.33333333332248946124e-03;
+    const double S3 = -1.98412698298579493134e-04;
+    const double S4 = 2.75573137070700676789e-06;
+    const double S5 = -2.50507602534068634195e-08;
+    const double S6 = 1.58969099521155010221e-10;
+
+    const double C1 = 4.16666666666666019037e-02;
+    const double C2 = -1.38888888888741095749e-03;
+    const double C3 = 2.48015872894767294178e-05;
+    const double C4 = -2.75573143513906633035e-07;
+    const double C5 = 2.08757232129817482790e-09;
+    const double C6 = -1.13596475577881948265e-11;
+
+    void SinCosOne(double x, double& s, double& c)
+    {
+        if (!(std::fabs(x) <= SinCosMaxArgument))
+        {
+            s = std::sin(x);
+            c = std::cos(x);
+            return;
+        }
+
+        double k = x * TwoOverPi + RoundMagic;
+        int64_t bits;
+        std::memcpy(&bits, &k, sizeof(bits));
+        double q = k - RoundMagic;
+
+        double r = x - q * PiO2_1;
+        r -= q * PiO2_2;
+        r -= q * PiO2_3;
+
+        double z = r * r;
+        double sr = r + r * z * (S1 + z * (S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)))));
+        double cr = 1.0 - 0.5 * z + z * z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+
+        switch (bits & 3)
+        {
+        case 0: s = sr;  c = cr;  break;
+        case 1: s = cr;  c = -sr; break;
+        case 2: s = -sr; c = -cr; break;
+        default: s = -cr; c = sr; break;
+        }
+    }
+
+    void SinCosScalar(const double* x, double* s, double* c, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+            SinCosOne(x[i], s[i], c[i]);
+    }
+
+#ifdef LICH_SINCOS_X86
+    void SinCosSse2(const double* x, double* s, double* c, size_t n)
+    {
+        const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+        const __m128d limit = _mm_set1_pd(SinCosMaxArgument);
+        const __m128d magic = _mm_set1_pd(RoundMagic);
+        const __m128i one = _mm_set1_epi64x(1);
+        const __m128i two = _mm_set1_epi64x(2);
+
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2)
+        {
+            __m128d v = _mm_loadu_pd(x + i);
+            if (_mm_movemask_pd(_mm_cmpnle_pd(_mm_and_pd(v, absMask), limit)))
+            {
+                SinCosScalar(x + i, s + i, c + i, 2);
+                continue;
+            }
+
+            __m128d k = _mm_add_pd(_mm_mul_pd(v, _mm_set1_pd(TwoOverPi)), magic);
+            __m128i quadrant = _mm_castpd_si128(k);
+            __m128d q = _mm_sub_pd(k, magic);
+
+            __m128d r = _mm_sub_pd(v, _mm_mul_pd(q, _mm_set1_pd(PiO2_1)));
+            r = _mm_sub_pd(r, _mm_mul_pd(q, _mm_set1_pd(PiO2_2)));
+            r = _mm_sub_pd(r, _mm_mul_pd(q, _mm_set1_pd(PiO2_3)));
+            __m128d z = _mm_mul_pd(r, r);
+
+            __m128d ps = _mm_add_pd(_mm_mul_pd(z, _mm_set1_pd(S6)), _mm_set1_pd(S5));
+            ps = _mm_add_pd(_mm_mul_pd(z, ps), _mm_set1_pd(S4));
+            ps = _mm_add_pd(_mm_mul_pd(z, ps), _mm_set1_pd(S3));
+            ps = _mm_add_pd(_mm_mul_pd(z, ps), _mm_set1_pd(S2));
+            ps = _mm_add_pd(_mm_mul_pd(z, ps), _mm_set1_pd(S1));
+            __m128d sr = _mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, z), ps));
+
+            __m128d pc = _mm_add_pd(_mm_mul_pd(z, _mm_set1_pd(C6)), _mm_set1_pd(C5));
+            pc = _mm_add_pd(_mm_mul_pd(z, pc), _mm_set1_pd(C4));
+            pc = _mm_add_pd(_mm_mul_pd(z, pc), _mm_set1_pd(C3));
+            pc = _mm_add_pd(_mm_mul_pd(z, pc), _mm_set1_pd(C2));
+            pc = _mm_add_pd(_mm_mul_pd(z, pc), _mm_set1_pd(C1));
+            __m128d cr = _mm_add_pd(_mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(_mm_set1_pd(0.5), z)),
+                _mm_mul_pd(_mm_mul_pd(z, z), pc));
+
+            // Odd quadrants swap sin and cos; bit 1 of q (of q + 1 for cos) flips the sign
+            __m128d swap = _mm_castsi128_pd(_mm_sub_epi64(_mm_setzero_si128(), _mm_and_si128(quadrant, one)));
+            __m128d sinSign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(quadrant, two), 62));
+            __m128d cosSign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(_mm_add_epi64(quadrant, one), two), 62));
+
+            __m128d sv = _mm_or_pd(_mm_and_pd(swap, cr), _mm_andnot_pd(swap, sr));
+            __m128d cv = _mm_or_pd(_mm_and_pd(swap, sr), _mm_andnot_pd(swap, cr));
+            _mm_storeu_pd(s + i, _mm_xor_pd(sv, sinSign));
+            _mm_storeu_pd(c + i, _mm_xor_pd(cv, cosSign));
+        }
+        SinCosScalar(x + i, s + i, c + i, n - i);
+    }
+
+    LICH_TARGET_AVX2 void SinCosAvx2(const double* x, double* s, double* c, size_t n)
+    {
+        const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+        const __m256d limit = _mm256_set1_pd(SinCosMaxArgument);
+        const __m256d magic = _mm256_set1_pd(RoundMagic);
+        const __m256i one = _mm256_set1_epi64x(1);
+        const __m256i two = _mm256_set1_epi64x(2);
+
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d v = _mm256_loadu_pd(x + i);
+            if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_and_pd(v, absMask), limit, _CMP_NLE_UQ)))
+            {
+                SinCosScalar(x + i, s + i, c + i, 4);
+                continue;
+            }
+
+            __m256d k = _mm256_fmadd_pd(v, _mm256_set1_pd(TwoOverPi), magic);
+            __m256i quadrant = _mm256_castpd_si256(k);
+            __m256d q = _mm256_sub_pd(k, magic);
+
+            __m256d r = _mm256_fnmadd_pd(q, _mm256_set1_pd(PiO2_1), v);
+            r = _mm256_fnmadd_pd(q, _mm256_set1_pd(PiO2_2), r);
+            r = _mm256_fnmadd_pd(q, _mm256_set1_pd(PiO2_3), r);
+            __m256d z = _mm256_mul_pd(r, r);
+
+            __m256d ps = _mm256_fmadd_pd(z, _mm256_set1_pd(S6), _mm256_set1_pd(S5));
+            ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(S4));
+            ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(S3));
+            ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(S2));
+            ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(S1));
+            __m256d sr = _mm256_fmadd_pd(_mm256_mul_pd(r, z), ps, r);
+
+            __m256d pc = _mm256_fmadd_pd(z, _mm256_set1_pd(C6), _mm256_set1_pd(C5));
+            pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(C4));
+            pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(C3));
+            pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(C2));
+            pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(C1));
+            __m256d cr = _mm256_fmadd_pd(_mm256_mul_pd(z, z), pc,
+                _mm256_fnmadd_pd(_mm256_set1_pd(0.5), z, _mm256_set1_pd(1.0)));
+
+            __m256d swap = _mm256_castsi256_pd(_mm256_sub_epi64(_mm256_setzero_si256(), _mm256_and_si256(quadrant, one)));
+            __m256d sinSign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(quadrant, two), 62));
+            __m256d cosSign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(quadrant, one), two), 62));
+
+            _mm256_storeu_pd(s + i, _mm256_xor_pd(_mm256_blendv_pd(sr, cr, swap), sinSign));
+            _mm256_storeu_pd(c + i, _mm256_xor_pd(_mm256_blendv_pd(cr, sr, swap), cosSign));
+        }
+        SinCosScalar(x + i, s + i, c + i, n - i);
+    }
+
+    bool CpuHasAvx2Fma()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        bool fma = (info[2] & (1 << 12)) != 0;
+        if (!osxsave || !avx || !fma) return false;
+        if ((_xgetbv(0) & 6) != 6) return false; // OS saves YMM state
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    }
+#endif
+
+    using SinCosKernel = void (*)(const double*, double*, double*, size_t);
+
+    struct KernelChoice
+    {
+        SinCosKernel kernel;
+        const char* name;
+    };
+
+    KernelChoice SelectKernel()
+    {
+#ifdef LICH_SINCOS_X86
+        if (CpuHasAvx2Fma()) return { SinCosAvx2, "avx2" };
+        return { SinCosSse2, "sse2" };
+#else
+        return { SinCosScalar, "scalar" };
+#endif
+    }
+
+    const KernelChoice& Kernel()
+    {
+        static const KernelChoice choice = SelectKernel();
+        return choice;
+    }
+}
+
+void SinCos(std::span<const double> x, std::span<double> s, std::span<double> c)
+{
+    Kernel().kernel(x.data(), s.data(), c.data(), x.size());
+}
+
+const char* SinCosKernelName()
+{
+    return Kernel().name;
+}
\ No newline at end of file
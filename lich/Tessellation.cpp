@@ -0,0 +1,247 @@
+#define _USE_MATH_DEFINES
+
+#include "Tessellation.h"
+#include "CurveVisit.h"
+#include <algorithm>
+#include <cmath>
+
+void TessellateCurve(const Curve3D& curve, int segments, std::vector<Vec3f>& out)
+{
+    if (segments <= 0)
+    {
+        out.clear();
+        return;
+    }
+
+    thread_local std::vector<double> ts;
+    thread_local std::vector<Point3D> points;
+    ts.resize(segments + 1);
+    points.resize(segments + 1);
+    for (int i = 0; i <= segments; ++i)
+        ts[i] = 2.0 * M_PI * ((double)i / segments);
+
+    curve.getPoints(ts, points);
+
+    out.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+        out[i] = { (float)points[i].x, (float)points[i].y, (float)points[i].z };
+}
+
+namespace
+{
+    // Probe resolution for the curvature estimate. A helix gets at least
+    // ProbesPerTurn intervals per turn: an interval that spans a whole turn
+    // sees the same tangent at both ends and measures no bending at all
+    const int ProbeIntervals = 64;
+    const int ProbesPerTurn = 8;
+    // Floor for maxDeviation; zero, negative or NaN would make the demand infinite
+    const double MinDeviation = 1e-9;
+
+    double Length(const Point3D& v)
+    {
+        return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    }
+
+    // Angle between two tangents, robust for nearly parallel vectors
+    double AngleBetween(const Point3D& a, const Point3D& b)
+    {
+        double cx = a.y * b.z - a.z * b.y;
+        double cy = a.z * b.x - a.x * b.z;
+        double cz = a.x * b.y - a.y * b.x;
+        double dot = a.x * b.x + a.y * b.y + a.z * b.z;
+        return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot);
+    }
+}
+
+void TessellateCurveAdaptive(const Curve3D& curve, const TessellationOptions& options, std::vector<Vec3f>& out)
+{
+    const double period = 2.0 * M_PI;
+    const Helix3D* helix = CurveAs<Helix3D>(&curve);
+    const int probes = std::max(ProbeIntervals, helix ? ProbesPerTurn * std::abs(helix->getTurns()) : 0);
+    const double dt = period / probes;
+    const double maxDeviation = options.maxDeviation > MinDeviation ? options.maxDeviation : MinDeviation;
+
+    thread_local std::vector<double> ts;
+    thread_local std::vector<Point3D> points;
+    thread_local std::vector<Point3D> tangents;
+    thread_local std::vector<double> probeTs;
+    thread_local std::vector<double> demand;
+    tangents.resize(probes + 1);
+    probeTs.resize(probes + 1);
+    demand.resize(probes);
+    for (int k = 0; k <= probes; ++k)
+        probeTs[k] = dt * k;
+    curve.getDerivatives(probeTs, tangents);
+
+    // Chords each probe interval needs; the sum is the total budget
+    double total = 0.0;
+    for (int k = 0; k < probes; ++k)
+    {
+        double ds = 0.5 * (Length(tangents[k]) + Length(tangents[k + 1])) * dt;
+        double dtheta = AngleBetween(tangents[k], tangents[k + 1]);
+        demand[k] = std::sqrt(ds * dtheta / (8.0 * maxDeviation));
+        total += demand[k];
+    }
+
+    // Clamped while still a double, so a huge demand cannot overflow the cast
+    int segments = (int)std::min(std::ceil(total), (double)options.maxSegments);
+    segments = std::max(options.minSegments, segments);
+    segments = std::max(segments, 1);
+
+    // Place samples at equal steps of accumulated demand (uniform for a flat curve)
+    ts.resize(segments + 1);
+    ts[0] = 0.0;
+    ts[segments] = period;
+    if (total <= 0.0)
+    {
+        for (int i = 1; i < segments; ++i)
+            ts[i] = period * ((double)i / segments);
+    }
+    else
+    {
+        double perSegment = total / segments;
+        double accumulated = 0.0;
+        int k = 0;
+        for (int i = 1; i < segments; ++i)
+        {
+            double target = perSegment * i;
+            while (k < probes - 1 && accumulated + demand[k] < target)
+                accumulated += demand[k++];
+            double fraction = demand[k] > 0.0 ? (target - accumulated) / demand[k] : 0.0;
+            fraction = std::max(0.0, std::min(1.0, fraction));
+            ts[i] = dt * (k + fraction);
+        }
+    }
+
+    points.resize(segments + 1);
+    curve.getPoints(ts, points);
+
+    out.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+        out[i] = { (float)points[i].x, (float)points[i].y, (float)points[i].z };
+}
+
+double PixelsToWorld(double pixels, double distance, double fovyDegrees, int screenHeight)
+{
+    double viewHeight = 2.0 * distance * std::tan(fovyDegrees * M_PI / 360.0);
+    return pixels * viewHeight / screenHeight;
+}
+
+TessellationCache::Entry& TessellationCache::touch(const Curve3D& curve)
+{
+    Entry& entry = entries[curve.id()];
+    if (entry.lastUse != frame)
+    {
+        entry.lastUse = frame;
+        ++usedCount;
+    }
+    return entry;
+}
+
+const std::vector<Vec3f>& TessellationCache::get(const Curve3D& curve, int segments)
+{
+    Entry& entry = touch(curve);
+    if (entry.points.empty() || entry.version != curve.version() || entry.segments != segments)
+    {
+        TessellateCurve(curve, segments, entry.points);
+        entry.version = curve.version();
+        entry.segments = segments;
+        ++resampledCount;
+    }
+    return entry.points;
+}
+
+bool TessellationCache::refresh(Entry& entry, const Curve3D& curve, const TessellationOptions& options)
+{
+    bool sameOptions = entry.segments == 0
+        && entry.options.maxDeviation == options.maxDeviation
+        && entry.options.minSegments == options.minSegments
+        && entry.options.maxSegments == options.maxSegments;
+    if (!entry.points.empty() && entry.version == curve.version() && sameOptions)
+        return false;
+
+    TessellateCurveAdaptive(curve, options, entry.points);
+    entry.version = curve.version();
+    entry.segments = 0;
+    entry.options = options;
+    entry.coarser.clear();
+    ++resampledCount;
+    return true;
+}
+
+const std::vector<Vec3f>& TessellationCache::get(const Curve3D& curve, const TessellationOptions& options)
+{
+    Entry& entry = touch(curve);
+    refresh(entry, curve, options);
+    return entry.points;
+}
+
+const std::vector<Vec3f>& TessellationCache::get(const Curve3D& curve, const TessellationOptions& options,
+    const LodOptions& lod, const LodView& view)
+{
+    Entry& entry = touch(curve);
+    refresh(entry, curve, options);
+
+    int levels = std::max(lod.levels, 1);
+    if (entry.coarser.size() != (size_t)(levels - 1) || entry.levelStep != lod.levelStep)
+    {
+        entry.coarser.clear();
+        entry.coarser.resize(levels - 1);
+        entry.levelStep = lod.levelStep;
+        entry.level = std::min(entry.level, levels - 1);
+    }
+
+    // Continuous level: level l is fine enough while l <= x
+    const BoundingSphere& sphere = curve.boundingSphere();
+    double distance = Length(Point3D(view.eye.x - sphere.center.x, view.eye.y - sphere.center.y, view.eye.z - sphere.center.z)) - sphere.radius;
+    double x = -1.0;
+    if (distance > 0.0 && lod.levelStep > 1.0)
+    {
+        double tolerance = PixelsToWorld(lod.pixelTolerance, distance, view.fovyDegrees, view.screenHeight);
+        x = std::log(tolerance / options.maxDeviation) / std::log(lod.levelStep);
+    }
+
+    // Stay put while x is within hysteresis of the current level's range
+    auto clampLevel = [&](double v) { return (int)std::max(0.0, std::min((double)(levels - 1), std::floor(v))); };
+    int coarsest = clampLevel(x + lod.hysteresis);
+    int finest = clampLevel(x - lod.hysteresis);
+    entry.level = std::max(finest, std::min(coarsest, entry.level));
+
+    if (entry.level == 0)
+        return entry.points;
+
+    std::vector<Vec3f>& points = entry.coarser[entry.level - 1];
+    if (points.empty())
+    {
+        TessellationOptions coarse = options;
+        coarse.maxDeviation = options.maxDeviation * std::pow(lod.levelStep, entry.level);
+        TessellateCurveAdaptive(curve, coarse, points);
+        ++resampledCount;
+    }
+    return points;
+}
+
+void TessellationCache::collect()
+{
+    // Only walk the map when something was not requested this frame
+    if (usedCount != entries.size())
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->second.lastUse != frame)
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+    ++frame;
+    usedCount = 0;
+    resampledCount = 0;
+}
+
+void TessellationCache::clear()
+{
+    entries.clear();
+    usedCount = 0;
+    resampledCount = 0;
+}
\ No newline at end of file
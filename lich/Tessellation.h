@@ -0,0 +1,109 @@
+#pragma once
+#include "Curve3D.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Render-precision point; what the renderer consumes
+struct Vec3f
+{
+    float x, y, z;
+};
+
+struct TessellationOptions
+{
+    // Largest allowed distance between a chord and the curve, in world units;
+    // values below 1e-9 (including zero and negative ones) count as 1e-9
+    double maxDeviation = 0.01;
+    int minSegments = 8;
+    int maxSegments = 4096;
+};
+
+// Samples the curve at segments + 1 uniform t in [0, 2pi]
+void TessellateCurve(const Curve3D& curve, int segments, std::vector<Vec3f>& out);
+
+// Samples the curve densely where it bends and sparsely where it is flat.
+// Curvature is estimated from getDerivative on a coarse probe, at least 8
+// intervals per helix turn; an arc of length ds turning by dtheta needs
+// sqrt(ds * dtheta / (8 * maxDeviation)) chords to stay within maxDeviation,
+// and samples are placed so every chord gets an equal share of that budget.
+void TessellateCurveAdaptive(const Curve3D& curve, const TessellationOptions& options, std::vector<Vec3f>& out);
+
+// Level-of-detail settings. Level i is tessellated with
+// maxDeviation * levelStep^i, so with the default step every level has about
+// half the vertices of the one before it.
+struct LodOptions
+{
+    int levels = 4;
+    double levelStep = 4.0;
+    // On-screen chord error a level may reach before a finer one is used
+    double pixelTolerance = 0.5;
+    // How far past a level boundary, in levels, the view has to move before
+    // the level changes; keeps curves near a boundary from flickering
+    double hysteresis = 0.2;
+};
+
+// Perspective view levels of detail are chosen for
+struct LodView
+{
+    Point3D eye;
+    double fovyDegrees = 45.0;
+    int screenHeight = 720;
+};
+
+// World-space length that covers `pixels` on screen at `distance` in front
+// of a perspective camera; turns a pixel error bound into maxDeviation
+double PixelsToWorld(double pixels, double distance, double fovyDegrees, int screenHeight);
+
+// Polylines keyed by Curve3D::id(). An entry is resampled only when the
+// curve's version() or the requested segment count changes, so a static
+// scene costs one lookup per curve per frame.
+class TessellationCache
+{
+public:
+    const std::vector<Vec3f>& get(const Curve3D& curve, int segments);
+    const std::vector<Vec3f>& get(const Curve3D& curve, const TessellationOptions& options);
+    // Coarsest level whose error stays within lod.pixelTolerance on screen,
+    // judged by the distance from view.eye to curve.boundingSphere().
+    // options give the finest level; coarser ones are built on first use and
+    // kept until the curve changes.
+    const std::vector<Vec3f>& get(const Curve3D& curve, const TessellationOptions& options,
+        const LodOptions& lod, const LodView& view);
+
+    // Keeps the curve's polylines through collect() without sampling it;
+    // for curves skipped this frame, e.g. culled ones
+    void retain(const Curve3D& curve) { touch(curve); }
+
+    // Call once per frame after drawing: drops polylines of curves that were
+    // not requested this frame (deleted or replaced ones)
+    void collect();
+    void clear();
+
+    size_t size() const { return entries.size(); }
+    // Polylines resampled since the last collect()
+    size_t resampled() const { return resampledCount; }
+
+private:
+    struct Entry
+    {
+        uint64_t version = 0;
+        int segments = 0; // 0 for adaptive entries
+        TessellationOptions options;
+        uint64_t lastUse = 0;
+        std::vector<Vec3f> points;
+
+        // Level of detail; coarser[i] is level i + 1, empty until first used
+        std::vector<std::vector<Vec3f>> coarser;
+        double levelStep = 0.0;
+        int level = 0;
+    };
+
+    Entry& touch(const Curve3D& curve);
+    // Resamples the finest adaptive polyline if it is stale; true if it was
+    bool refresh(Entry& entry, const Curve3D& curve, const TessellationOptions& options);
+
+    std::unordered_map<uint64_t, Entry> entries;
+    uint64_t frame = 1;
+    size_t usedCount = 0;
+    size_t resampledCount = 0;
+};
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "Transform3D.h"
+#include <cmath>
+
+Transform3D::Transform3D()
+    : m{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } } {
+}
+
+Transform3D::Transform3D(const Point3D& position, const Point3D& rotation)
+{
+    setRotation(rotation);
+    setTranslation(position);
+}
+
+void Transform3D::setRotation(const Point3D& rotation)
+{
+    double cosX = cos(rotation.x), sinX = sin(rotation.x);
+    double cosY = cos(rotation.y), sinY = sin(rotation.y);
+    double cosZ = cos(rotation.z), sinZ = sin(rotation.z);
+
+    // Rx * Ry * Rz
+    m[0][0] = cosY * cosZ;
+    m[0][1] = -cosY * sinZ;
+    m[0][2] = sinY;
+
+    m[1][0] = cosX * sinZ + sinX * sinY * cosZ;
+    m[1][1] = cosX * cosZ - sinX * sinY * sinZ;
+    m[1][2] = -sinX * cosY;
+
+    m[2][0] = sinX * sinZ - cosX * sinY * cosZ;
+    m[2][1] = sinX * cosZ + cosX * sinY * sinZ;
+    m[2][2] = cosX * cosY;
+}
+
+void Transform3D::setTranslation(const Point3D& position)
+{
+    m[0][3] = position.x;
+    m[1][3] = position.y;
+    m[2][3] = position.z;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include "Point3D.h"
+
+// Local-to-world transform of a curve: rotation about Z, then Y, then X
+// (the order getPoint always used), followed by translation.
+// Stored as a 3x4 matrix so evaluation costs no trig.
+class Transform3D
+{
+public:
+    double m[3][4];
+
+    Transform3D();
+    Transform3D(const Point3D& position, const Point3D& rotation);
+
+    void setRotation(const Point3D& rotation);
+    void setTranslation(const Point3D& position);
+
+    Point3D applyPoint(double x, double y, double z) const
+    {
+        return Point3D(m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3],
+            m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3],
+            m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3]);
+    }
+
+    Point3D applyVector(double x, double y, double z) const
+    {
+        return Point3D(m[0][0] * x + m[0][1] * y + m[0][2] * z,
+            m[1][0] * x + m[1][1] * y + m[1][2] * z,
+            m[2][0] * x + m[2][1] * y + m[2][2] * z);
+    }
+
+    // World to local direction: the rotation is orthonormal, so its inverse is the transpose
+    Point3D applyInverseVector(double x, double y, double z) const
+    {
+        return Point3D(m[0][0] * x + m[1][0] * y + m[2][0] * z,
+            m[0][1] * x + m[1][1] * y + m[2][1] * z,
+            m[0][2] * x + m[1][2] * y + m[2][2] * z);
+    }
+};
\ No newline at end of file
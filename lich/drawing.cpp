@@ -2,10 +2,14 @@
 
 #include "drawing.h"
 #include "raylib.h"
+#include "rlgl.h"
+#include "raymath.h"
 #include <cmath>
-#include "Circle.h"
-#include "Ellipse.h"
-#include "Helix.h"
+#include "CurveVisit.h"
+#include "Tessellation.h"
+#include "LineBuffer.h"
+#include "Bounds.h"
+#include <algorithm>
 
 Vector3 ToVec3(const Point3D& p)
 {
@@ -19,30 +23,111 @@ Point3D ToPoint3D(const Vector3& v)
 
 void DrawCurve3D(const std::shared_ptr<Curve3D>& curve, int segments, Color col)
 {
-    if (!curve) return;
+    if (!curve || segments <= 0) return;
     double t0 = 0.0;
     double t1 = 2.0 * M_PI;
-    Point3D prev = curve->getPoint(t0);
+
+    // Буферы переиспользуются между вызовами, чтобы не выделять память каждый кадр
+    static std::vector<double> ts;
+    static std::vector<Point3D> points;
+    ts.resize(segments + 1);
+    points.resize(segments + 1);
+    for (int i = 0; i <= segments; ++i)
+        ts[i] = t0 + (t1 - t0) * ((double)i / segments);
+
+    // Один вызов на кривую вместо виртуального getPoint на каждую точку
+    curve->getPoints(ts, points);
+
     for (int i = 1; i <= segments; ++i)
+        DrawLine3D(ToVec3(points[i - 1]), ToVec3(points[i]), col);
+}
+
+// Полилинии кривых переживают кадр и пересчитываются только после изменения кривой
+static TessellationCache tessellationCache;
+
+// Вершины всех линий кадра; память переиспользуется между кадрами
+static LineBuffer lineBuffer;
+
+// Пирамида видимости текущей камеры; вызывать между BeginMode3D и EndMode3D,
+// когда в rlgl уже загружены матрицы вида и проекции
+static Frustum CurrentFrustum()
+{
+    Matrix m = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    const float columns[16] = {
+        m.m0, m.m1, m.m2, m.m3, m.m4, m.m5, m.m6, m.m7,
+        m.m8, m.m9, m.m10, m.m11, m.m12, m.m13, m.m14, m.m15
+    };
+    return Frustum::FromMatrix(columns);
+}
+
+static Rgba8 ToRgba8(Color c)
+{
+    return { c.r, c.g, c.b, c.a };
+}
+
+// Отправляет готовый буфер через rlgl: вершины копируются в пакет rlgl,
+// который уходит на GPU одним вызовом отрисовки при заполнении или в конце кадра
+static void SubmitLineBuffer(const LineBuffer& buffer)
+{
+    const std::vector<LineVertex>& vertices = buffer.vertices();
+    const size_t chunk = 4096; // четное, чтобы отрезок не разрывался между пакетами
+
+    for (size_t first = 0; first < vertices.size(); first += chunk)
     {
-        double tt = t0 + (t1 - t0) * ((double)i / segments);
-        Point3D p = curve->getPoint(tt);
-        DrawLine3D(ToVec3(prev), ToVec3(p), col);
-        prev = p;
+        size_t count = std::min(chunk, vertices.size() - first);
+        rlCheckRenderBatchLimit((int)count);
+
+        rlBegin(RL_LINES);
+        Rgba8 current = vertices[first].color;
+        rlColor4ub(current.r, current.g, current.b, current.a);
+        for (size_t i = first; i < first + count; ++i)
+        {
+            const LineVertex& v = vertices[i];
+            if (v.color.r != current.r || v.color.g != current.g || v.color.b != current.b || v.color.a != current.a)
+            {
+                current = v.color;
+                rlColor4ub(current.r, current.g, current.b, current.a);
+            }
+            rlVertex3f(v.x, v.y, v.z);
+        }
+        rlEnd();
     }
 }
 
 void DrawAllCurves(const std::vector<std::shared_ptr<Curve3D>>& curves, int selectedCurve,
-    const Point3D& currentPoint, const Point3D& currentDerivative, bool calculated)
+    const Point3D& currentPoint, const Point3D& currentDerivative, bool calculated,
+    const TessellationOptions& tessellation, const LodOptions& lod, const Camera3D& camera)
 {
+    lineBuffer.clear();
+
+    LodView view;
+    view.eye = ToPoint3D(camera.position);
+    view.fovyDegrees = camera.fovy;
+    view.screenHeight = GetScreenHeight();
+
+    Frustum frustum = CurrentFrustum();
+
     for (int i = 0; i < curves.size(); ++i)
     {
         auto& c = curves[i];
         Color col = (i == selectedCurve) ? ORANGE : GRAY;
-        if (std::dynamic_pointer_cast<Circle3D>(c)) col = RED;
-        if (std::dynamic_pointer_cast<Ellipse3D>(c)) col = GREEN;
-        if (std::dynamic_pointer_cast<Helix3D>(c)) col = BLUE;
-        DrawCurve3D(c, 300, col);
+        switch (c->kind())
+        {
+        case CurveKind::Circle: col = RED; break;
+        case CurveKind::Ellipse: col = GREEN; break;
+        case CurveKind::Helix: col = BLUE; break;
+        }
+        // Кривые вне кадра не сэмплируются и не отправляются; их полилинии остаются в кэше
+        if (frustum.intersects(c->bounds()))
+        {
+            // Плотность точек зависит от кривизны: маленькой окружности хватает десятка отрезков.
+            // Дальние кривые берут более грубый уровень детализации из кэша
+            lineBuffer.addPolyline(tessellationCache.get(*c, tessellation, lod, view), ToRgba8(col));
+        }
+        else
+        {
+            tessellationCache.retain(*c);
+        }
 
         // Для выбранной кривой дополнительно рисуем маркеры
         if (i == selectedCurve)
@@ -73,4 +158,10 @@ void DrawAllCurves(const std::vector<std::shared_ptr<Curve3D>>& curves, int sele
             }
         }
     }
+
+    // Все кривые уходят одним буфером вместо DrawLine3D на каждый отрезок
+    SubmitLineBuffer(lineBuffer);
+
+    // Удаленные и замененные кривые освобождают свои полилинии
+    tessellationCache.collect();
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "Point3D.h"
 #include "Curve3D.h"
+#include "Tessellation.h"
 #include <vector>
 #include <memory>
 #include "raylib.h"
@@ -9,4 +10,5 @@ Vector3 ToVec3(const Point3D& p);
 Point3D ToPoint3D(const Vector3& v);
 void DrawCurve3D(const std::shared_ptr<Curve3D>& curve, int segments = 200, Color col = BLUE);
 void DrawAllCurves(const std::vector<std::shared_ptr<Curve3D>>& curves, int selectedCurve,
-    const Point3D& currentPoint, const Point3D& currentDerivative, bool calculated);
\ No newline at end of file
+    const Point3D& currentPoint, const Point3D& currentDerivative, bool calculated,
+    const TessellationOptions& tessellation, const LodOptions& lod, const Camera3D& camera);
\ No newline at end of file
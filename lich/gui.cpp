@@ -3,13 +3,60 @@
 #include "gui.h"
 #include "drawing.h"
 #include "tasks.h"
+#include "CurveVisit.h"
+#include "Picking.h"
+#include "SceneFile.h"
+#include "SceneText.h"
 #include "raylib.h"
 #include "raygui.h"
 #include <cmath>
-#include <iostream>
 #include <cstring>
 #include <string>
 
+// Индекс радиусов следит за окружностями в state.curves: каждое изменение
+// списка кривых сразу отражается в нем
+static void IndexCurve(AppState& state, const Curve3D& curve)
+{
+    if (auto circle = CurveAs<Circle3D>(&curve))
+        state.circleIndex.insert(circle->id(), circle->getRadius());
+}
+
+static void UnindexCurve(AppState& state, const Curve3D& curve)
+{
+    state.circleIndex.erase(curve.id());
+}
+
+static void RebuildCircleIndex(AppState& state)
+{
+    state.circleIndex.clear();
+    for (const auto& curve : state.curves)
+        IndexCurve(state, *curve);
+}
+
+// Номера кривых в иерархии сдвигаются при вставке и удалении, поэтому она
+// строится заново; правка одной кривой обходится RefitCurve
+static void RebuildCurveBvh(AppState& state)
+{
+    state.bvh.build(state.curves);
+}
+
+static void RefitCurve(AppState& state, int index)
+{
+    state.bvh.refit(index, state.curves[index]->bounds());
+}
+
+// Текстовый формат по расширению файла сцены; остальные файлы двоичные
+static bool TextSceneFormat(const std::string& path, SceneTextFormat& format)
+{
+    if (path.ends_with(".csv"))
+        format = SceneTextFormat::Csv;
+    else if (path.ends_with(".jsonl"))
+        format = SceneTextFormat::JsonLines;
+    else
+        return false;
+    return true;
+}
+
 // Инициализация состояния приложения с пустыми полями
 void InitializeAppState(AppState& state)
 {
@@ -43,11 +90,19 @@ void InitializeAppState(AppState& state)
     state.editPosX = state.editPosY = state.editPosZ = false;
     state.editRotX = state.editRotY = state.editRotZ = false;
     state.editTValue = false;
+    state.editRangeMin = state.editRangeMax = false;
+    state.rangeMin = "0.0";
+    state.rangeMax = "5.0";
+    state.scenePath = "scene.lich";
+    state.editScenePath = false;
 
     // Инициализация новых полей
     state.currentPoint = Point3D();
     state.currentDerivative = Point3D();
     state.calculated = false;
+
+    // Допуск тесселяции: полпикселя на расстоянии камеры по умолчанию от центра сцены
+    state.tessellation.maxDeviation = PixelsToWorld(0.5, 17.3, 45.0, 720);
 }
 
 // Заполнение полей редактирования значениями из выбранной кривой
@@ -60,27 +115,26 @@ void FillEditFieldsFromSelectedCurve(AppState& state)
     // Заполняем позицию и вращение
     Point3D position;
     Point3D rotation;
-    if (auto circle = std::dynamic_pointer_cast<Circle3D>(curve)) {
-        position = circle->getPosition();
-        rotation = circle->getRotation();
-        state.curveType = 0;
-        state.circleRadius = std::to_string(circle->getRadius());
-    }
-    else if (auto ellipse = std::dynamic_pointer_cast<Ellipse3D>(curve)) {
-        position = ellipse->getPosition();
-        rotation = ellipse->getRotation();
-        state.curveType = 1;
-        state.ellipseA = std::to_string(ellipse->getA());
-        state.ellipseB = std::to_string(ellipse->getB());
-    }
-    else if (auto helix = std::dynamic_pointer_cast<Helix3D>(curve)) {
-        position = helix->getPosition();
-        rotation = helix->getRotation();
-        state.curveType = 2;
-        state.helixRadius = std::to_string(helix->getRadius());
-        state.helixStep = std::to_string(helix->getStep());
-        state.helixTurns = std::to_string(helix->getTurns());
-    }
+    state.curveType = (int)curve->kind();
+    VisitCurve(*curve, Overloaded{
+        [&](const Circle3D& circle) {
+            position = circle.getPosition();
+            rotation = circle.getRotation();
+            state.circleRadius = std::to_string(circle.getRadius());
+        },
+        [&](const Ellipse3D& ellipse) {
+            position = ellipse.getPosition();
+            rotation = ellipse.getRotation();
+            state.ellipseA = std::to_string(ellipse.getA());
+            state.ellipseB = std::to_string(ellipse.getB());
+        },
+        [&](const Helix3D& helix) {
+            position = helix.getPosition();
+            rotation = helix.getRotation();
+            state.helixRadius = std::to_string(helix.getRadius());
+            state.helixStep = std::to_string(helix.getStep());
+            state.helixTurns = std::to_string(helix.getTurns());
+        } });
 
     // Заполняем координаты позиции
     state.posX = std::to_string(position.x);
@@ -93,10 +147,15 @@ void FillEditFieldsFromSelectedCurve(AppState& state)
     state.rotZ = std::to_string(rotation.z);
 }
 
+// Правая панель; щелчки по ней не выбирают кривые в 3D-виде
+static const Rectangle MainPanelBounds = { 960, 0, 320, (float)720 };
+
+// Допуск выбора кривой мышью, в пикселях от курсора
+static const double PickTolerancePixels = 6.0;
+
 void DrawMainPanel(AppState& state)
 {
-    Rectangle panel = { 960, 0, 320, (float)720 };
-    GuiPanel(panel, "Curve Editor");
+    GuiPanel(MainPanelBounds, "Curve Editor");
 
     // Основные кнопки
     if (GuiButton({ 980, 40, 120, 30 }, "Add Curve"))
@@ -127,7 +186,9 @@ void DrawMainPanel(AppState& state)
 
     if (GuiButton({ 1120, 80, 120, 30 }, "Delete") && state.selectedCurve >= 0)
     {
+        UnindexCurve(state, *state.curves[state.selectedCurve]);
         state.curves.erase(state.curves.begin() + state.selectedCurve);
+        RebuildCurveBvh(state);
         state.selectedCurve = -1;
         state.calculated = false; // Сбрасываем расчет при удалении кривой
     }
@@ -139,10 +200,7 @@ void DrawMainPanel(AppState& state)
     DrawText("Curves:", 980, 120, 20, DARKGRAY);
     for (int i = 0; i < (int)state.curves.size(); ++i)
     {
-        std::string label = std::to_string(i + 1) + ". ";
-        if (std::dynamic_pointer_cast<Circle3D>(state.curves[i])) label += "Circle";
-        else if (std::dynamic_pointer_cast<Ellipse3D>(state.curves[i])) label += "Ellipse";
-        else if (std::dynamic_pointer_cast<Helix3D>(state.curves[i])) label += "Helix";
+        std::string label = std::to_string(i + 1) + ". " + CurveKindName(state.curves[i]->kind());
 
         if (GuiButton({ 980, 150.0f + i * 40, 140, 30 }, label.c_str()))
         {
@@ -175,24 +233,20 @@ void DrawMainPanel(AppState& state)
         try {
             // Используем актуальное значение из state
             double t = std::stod(state.tValue);
-            state.currentPoint = state.curves[state.selectedCurve]->getPoint(t);
-            state.currentDerivative = state.curves[state.selectedCurve]->getDerivative(t);
+            CurveSample sample = state.curves[state.selectedCurve]->evaluate(t, 1);
+            state.currentPoint = sample.point;
+            state.currentDerivative = sample.derivative;
             state.calculated = true;
 
-            std::cout << "=== Calculation for t = " << t << " ===" << std::endl;
-            std::cout << "Selected curve " << state.selectedCurve + 1 << ": ";
-            if (auto circle = std::dynamic_pointer_cast<Circle3D>(state.curves[state.selectedCurve]))
-                std::cout << "Circle (r=" << circle->getRadius() << ")";
-            else if (auto ellipse = std::dynamic_pointer_cast<Ellipse3D>(state.curves[state.selectedCurve]))
-                std::cout << "Ellipse (a=" << ellipse->getA() << ", b=" << ellipse->getB() << ")";
-            else if (auto helix = std::dynamic_pointer_cast<Helix3D>(state.curves[state.selectedCurve]))
-                std::cout << "Helix (r=" << helix->getRadius() << ", step=" << helix->getStep() << ", turns=" << helix->getTurns() << ")";
-
-            std::cout << "\n  Point: " << state.currentPoint;
-            std::cout << "\n  Derivative: " << state.currentDerivative << std::endl << std::endl;
+            OutputWriter out;
+            out << "=== Calculation for t = " << t << " ===\n";
+            out << "Selected curve " << state.selectedCurve + 1 << ": ";
+            WriteCurveDescription(out, *state.curves[state.selectedCurve]);
+            out << "\n  Point: " << state.currentPoint;
+            out << "\n  Derivative: " << state.currentDerivative << "\n\n";
         }
         catch (const std::exception& e) {
-            std::cout << "Error: Invalid t value" << std::endl;
+            OutputWriter() << "Error: Invalid t value\n";
         }
     }
 
@@ -443,15 +497,16 @@ void HandleAddWindow(AppState& state)
 
             if (state.curveType == 0) {
                 double radius = std::stod(state.circleRadius);
-                auto circle = std::make_shared<Circle3D>(radius);
+                auto circle = state.arena.make<Circle3D>(radius);
                 circle->setPosition(position);
                 circle->setRotation(rotation);
                 state.curves.push_back(circle);
+                IndexCurve(state, *circle);
             }
             else if (state.curveType == 1) {
                 double a = std::stod(state.ellipseA);
                 double b = std::stod(state.ellipseB);
-                auto ellipse = std::make_shared<Ellipse3D>(a, b);
+                auto ellipse = state.arena.make<Ellipse3D>(a, b);
                 ellipse->setPosition(position);
                 ellipse->setRotation(rotation);
                 state.curves.push_back(ellipse);
@@ -460,11 +515,12 @@ void HandleAddWindow(AppState& state)
                 double radius = std::stod(state.helixRadius);
                 double step = std::stod(state.helixStep);
                 int turns = std::stoi(state.helixTurns);
-                auto helix = std::make_shared<Helix3D>(radius, step, turns);
+                auto helix = state.arena.make<Helix3D>(radius, step, turns);
                 helix->setPosition(position);
                 helix->setRotation(rotation);
                 state.curves.push_back(helix);
             }
+            RebuildCurveBvh(state);
             state.showAddWindow = false;
         }
         catch (const std::exception& e) {
@@ -485,10 +541,8 @@ void HandleEditWindow(AppState& state)
     GuiWindowBox(editWindow, "Edit Curve");
 
     // Отображаем тип текущей кривой
-    std::string typeLabel = "Type: ";
-    if (auto circle = std::dynamic_pointer_cast<Circle3D>(state.curves[state.selectedCurve])) typeLabel += "Circle";
-    else if (auto ellipse = std::dynamic_pointer_cast<Ellipse3D>(state.curves[state.selectedCurve])) typeLabel += "Ellipse";
-    else if (auto helix = std::dynamic_pointer_cast<Helix3D>(state.curves[state.selectedCurve])) typeLabel += "Helix";
+    CurveKind kind = state.curves[state.selectedCurve]->kind();
+    std::string typeLabel = std::string("Type: ") + CurveKindName(kind);
 
     GuiLabel({ editWindow.x + 20, editWindow.y + 40, 360, 25 }, typeLabel.c_str());
 
@@ -508,7 +562,7 @@ void HandleEditWindow(AppState& state)
 
     // Параметры в зависимости от типа
     int yOffset = 80;
-    if (auto circle = std::dynamic_pointer_cast<Circle3D>(state.curves[state.selectedCurve]))
+    if (kind == CurveKind::Circle)
     {
         GuiLabel({ editWindow.x + 20, editWindow.y + yOffset, 100, 25 }, "Radius:");
 
@@ -526,7 +580,7 @@ void HandleEditWindow(AppState& state)
         }
         yOffset += 40;
     }
-    else if (auto ellipse = std::dynamic_pointer_cast<Ellipse3D>(state.curves[state.selectedCurve]))
+    else if (kind == CurveKind::Ellipse)
     {
         GuiLabel({ editWindow.x + 20, editWindow.y + yOffset, 100, 25 }, "A:");
 
@@ -560,7 +614,7 @@ void HandleEditWindow(AppState& state)
         }
         yOffset += 40;
     }
-    else if (auto helix = std::dynamic_pointer_cast<Helix3D>(state.curves[state.selectedCurve]))
+    else if (kind == CurveKind::Helix)
     {
         GuiLabel({ editWindow.x + 20, editWindow.y + yOffset, 100, 25 }, "Radius:");
 
@@ -714,24 +768,25 @@ void HandleEditWindow(AppState& state)
             double rz = std::stod(state.rotZ);
             Point3D rotation(rx, ry, rz);
 
-            if (auto circle = std::dynamic_pointer_cast<Circle3D>(state.curves[state.selectedCurve]))
+            // Кривая меняется на месте, без новой аллокации
+            if (auto circle = CurveAs<Circle3D>(state.curves[state.selectedCurve]))
             {
                 double radius = std::stod(state.circleRadius);
-                auto newCircle = std::make_shared<Circle3D>(radius);
-                newCircle->setPosition(position);
-                newCircle->setRotation(rotation);
-                state.curves[state.selectedCurve] = newCircle;
+                UnindexCurve(state, *circle);
+                circle->setRadius(radius);
+                circle->setPosition(position);
+                circle->setRotation(rotation);
+                IndexCurve(state, *circle);
             }
-            else if (auto ellipse = std::dynamic_pointer_cast<Ellipse3D>(state.curves[state.selectedCurve]))
+            else if (auto ellipse = CurveAs<Ellipse3D>(state.curves[state.selectedCurve]))
             {
                 double a = std::stod(state.ellipseA);
                 double b = std::stod(state.ellipseB);
-                auto newEllipse = std::make_shared<Ellipse3D>(a, b);
-                newEllipse->setPosition(position);
-                newEllipse->setRotation(rotation);
-                state.curves[state.selectedCurve] = newEllipse;
+                ellipse->setAxes(a, b);
+                ellipse->setPosition(position);
+                ellipse->setRotation(rotation);
             }
-            else if (auto helix = std::dynamic_pointer_cast<Helix3D>(state.curves[state.selectedCurve]))
+            else if (auto helix = CurveAs<Helix3D>(state.curves[state.selectedCurve]))
             {
                 double radius = std::stod(state.helixRadius);
                 double step = std::stod(state.helixStep);
@@ -742,6 +797,7 @@ void HandleEditWindow(AppState& state)
                 helix->setPosition(position);
                 helix->setRotation(rotation);
             }
+            RefitCurve(state, state.selectedCurve);
             state.showEditWindow = false;
         }
         catch (const std::exception& e) {
@@ -764,7 +820,9 @@ void HandleTaskWindow(AppState& state)
     GuiLabel({ taskWindow.x + 20, taskWindow.y + 40, 460, 25 }, "Task 1-2: Generate random curves");
     if (GuiButton({ taskWindow.x + 20, taskWindow.y + 70, 200, 30 }, "Generate 10 Random Curves"))
     {
-        Task1_GenerateRandomCurves(state.curves, 10);
+        Task1_GenerateRandomCurves(state.curves, 10, &state.arena);
+        RebuildCircleIndex(state);
+        RebuildCurveBvh(state);
     }
 
     GuiLabel({ taskWindow.x + 20, taskWindow.y + 120, 460, 25 }, "Task 3: Print points and derivatives");
@@ -776,9 +834,114 @@ void HandleTaskWindow(AppState& state)
     GuiLabel({ taskWindow.x + 20, taskWindow.y + 200, 460, 25 }, "Task 4-6: Circle operations");
     if (GuiButton({ taskWindow.x + 20, taskWindow.y + 230, 200, 30 }, "Execute Circle Tasks"))
     {
-        Task4_5_6_CirclesOperations(state.curves);
+        Task4_5_6_CirclesOperations(state.circleIndex);
+    }
+
+    // Окружности с радиусом в диапазоне [min, max]: ответ из индекса без перебора
+    GuiLabel({ taskWindow.x + 20, taskWindow.y + 280, 100, 25 }, "Radius range:");
+
+    static char rangeMinBuffer[32] = "0.0";
+    static char rangeMaxBuffer[32] = "5.0";
+    if (!state.editRangeMin && state.rangeMin != rangeMinBuffer) {
+        strncpy(rangeMinBuffer, state.rangeMin.c_str(), sizeof(rangeMinBuffer) - 1);
+        rangeMinBuffer[sizeof(rangeMinBuffer) - 1] = '\0';
+    }
+    if (!state.editRangeMax && state.rangeMax != rangeMaxBuffer) {
+        strncpy(rangeMaxBuffer, state.rangeMax.c_str(), sizeof(rangeMaxBuffer) - 1);
+        rangeMaxBuffer[sizeof(rangeMaxBuffer) - 1] = '\0';
+    }
+
+    if (GuiTextBox({ taskWindow.x + 120, taskWindow.y + 280, 60, 25 }, rangeMinBuffer, sizeof(rangeMinBuffer) - 1, state.editRangeMin)) {
+        state.editRangeMin = !state.editRangeMin;
+        if (!state.editRangeMin) state.rangeMin = rangeMinBuffer;
+    }
+    if (GuiTextBox({ taskWindow.x + 190, taskWindow.y + 280, 60, 25 }, rangeMaxBuffer, sizeof(rangeMaxBuffer) - 1, state.editRangeMax)) {
+        state.editRangeMax = !state.editRangeMax;
+        if (!state.editRangeMax) state.rangeMax = rangeMaxBuffer;
+    }
+
+    std::string rangeText;
+    try {
+        RadiusIndex::Range range = state.circleIndex.range(std::stod(state.rangeMin), std::stod(state.rangeMax));
+        rangeText = std::to_string(range.count) + " circles, sum " + std::to_string(range.sum);
+    }
+    catch (const std::exception& e) {
+        (void)e;
+        rangeText = "invalid range";
+    }
+    GuiLabel({ taskWindow.x + 260, taskWindow.y + 280, 220, 25 }, rangeText.c_str());
+
+    // Сохранение и загрузка сцены: путь и кнопки рядом с Close
+    static char scenePathBuffer[256] = "";
+    if (!state.editScenePath && state.scenePath != scenePathBuffer) {
+        strncpy(scenePathBuffer, state.scenePath.c_str(), sizeof(scenePathBuffer) - 1);
+        scenePathBuffer[sizeof(scenePathBuffer) - 1] = '\0';
+    }
+
+    GuiLabel({ taskWindow.x + 20, taskWindow.y + 315, 100, 25 }, "Scene file:");
+    if (GuiTextBox({ taskWindow.x + 120, taskWindow.y + 315, 360, 25 }, scenePathBuffer, sizeof(scenePathBuffer) - 1, state.editScenePath)) {
+        state.editScenePath = !state.editScenePath;
+        if (!state.editScenePath) {
+            state.scenePath = scenePathBuffer;
+        }
+    }
+
+    if (GuiButton({ taskWindow.x + 20, taskWindow.y + 350, 120, 30 }, "Save")) {
+        try {
+            SceneTextFormat format;
+            if (TextSceneFormat(state.scenePath, format))
+                ExportSceneText(state.scenePath, format, state.curves);
+            else
+                SaveScene(state.scenePath, state.curves);
+        }
+        catch (const std::exception& e) {
+            OutputWriter() << "Error: " << e.what() << '\n';
+        }
+    }
+
+    if (GuiButton({ taskWindow.x + 150, taskWindow.y + 350, 120, 30 }, "Load")) {
+        try {
+            // При ошибке в файле текущая сцена остается нетронутой
+            std::vector<std::shared_ptr<Curve3D>> loaded;
+            SceneTextFormat format;
+            if (TextSceneFormat(state.scenePath, format))
+                ImportSceneText(state.scenePath, format, loaded, &state.arena);
+            else
+                MappedScene(state.scenePath).load(loaded, &state.arena);
+            state.curves.swap(loaded);
+            RebuildCircleIndex(state);
+            RebuildCurveBvh(state);
+            state.selectedCurve = -1;
+            state.calculated = false;
+        }
+        catch (const std::exception& e) {
+            OutputWriter() << "Error: " << e.what() << '\n';
+        }
     }
 
     if (GuiButton({ taskWindow.x + 350, taskWindow.y + 350, 120, 30 }, "Close"))
         state.showTaskWindow = false;
-}   
\ No newline at end of file
+}   
+
+// Выбор кривой щелчком в 3D-виде: луч из камеры через курсор ищет ближайшую
+// по углу кривую в иерархии рамок; щелчок мимо кривых снимает выделение
+void HandleViewportPicking(AppState& state, const Camera3D& camera)
+{
+    if (!state.guiMode || !IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        return;
+    if (state.showAddWindow || state.showEditWindow || state.showTaskWindow)
+        return;
+
+    Vector2 mouse = GetMousePosition();
+    if (state.panelVisible && CheckCollisionPointRec(mouse, MainPanelBounds))
+        return;
+
+    Ray ray = GetMouseRay(mouse, camera);
+    double tolerance = PixelsToAngle(PickTolerancePixels, camera.fovy, GetScreenHeight());
+    CurvePick pick = PickCurve(state.bvh, state.curves, Ray3D(ToPoint3D(ray.position), ToPoint3D(ray.direction)), tolerance);
+    if (pick.curve != state.selectedCurve)
+    {
+        state.selectedCurve = (int)pick.curve;
+        state.calculated = false; // Сбрасываем расчет при выборе новой кривой
+    }
+}
\ No newline at end of file
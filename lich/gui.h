@@ -4,11 +4,18 @@
 #include "Helix.h"
 #include "Circle.h"
 #include "Ellipse.h"
+#include "Tessellation.h"
+#include "RadiusIndex.h"
+#include "CurveArena.h"
+#include "CurveBvh.h"
+#include "raylib.h"
 #include <vector>
 #include <memory>
 #include <string>
 
 struct AppState {
+    // Память кривых сцены; объявлена раньше curves, чтобы освобождаться после них
+    CurveArena arena;
     std::vector<std::shared_ptr<Curve3D>> curves;
     int selectedCurve;
     bool panelVisible;
@@ -41,6 +48,23 @@ struct AppState {
     Point3D currentPoint;
     Point3D currentDerivative;
     bool calculated;
+
+    TessellationOptions tessellation;
+    LodOptions lod;
+
+    // Окружности из curves, упорядоченные по радиусу; обновляется вместе с curves
+    RadiusIndex circleIndex;
+    std::string rangeMin;
+    std::string rangeMax;
+    bool editRangeMin, editRangeMax;
+
+    // Иерархия рамок над curves для выбора мышью и запросов по области:
+    // перестраивается при добавлении и удалении кривых, при правке обновляется
+    CurveBvh bvh;
+
+    // Файл сцены для Save/Load
+    std::string scenePath;
+    bool editScenePath;
 };
 
 void InitializeAppState(AppState& state);
@@ -48,4 +72,5 @@ void FillEditFieldsFromSelectedCurve(AppState& state);
 void DrawMainPanel(AppState& state);
 void HandleAddWindow(AppState& state);
 void HandleEditWindow(AppState& state);
-void HandleTaskWindow(AppState& state);
\ No newline at end of file
+void HandleTaskWindow(AppState& state);
+void HandleViewportPicking(AppState& state, const Camera3D& camera);
\ No newline at end of file
@@ -71,13 +71,16 @@ int main()
             }
         }
 
+        // Выбор кривой щелчком мыши в GUI-режиме
+        HandleViewportPicking(state, camera);
+
         BeginDrawing();
         ClearBackground(RAYWHITE);
 
         // Отрисовка 3D сцены
         BeginMode3D(camera);
         DrawGrid(20, 1.0f);
-        DrawAllCurves(state.curves, state.selectedCurve, state.currentPoint, state.currentDerivative, state.calculated);
+        DrawAllCurves(state.curves, state.selectedCurve, state.currentPoint, state.currentDerivative, state.calculated, state.tessellation, state.lod, camera);
         EndMode3D();
 
         // Отрисовка GUI
@@ -95,6 +98,7 @@ int main()
         DrawText("Mouse wheel = Zoom in/out", 10, 10, 18, DARKGRAY);
         DrawText("Mouse right button = Rotate", 10, 35, 18, DARKGRAY);
         DrawText("TAB = Toggle GUI mode", 10, 60, 18, DARKGRAY);
+        DrawText("Left click in GUI mode = Select curve", 10, 85, 18, DARKGRAY);
 
         EndDrawing();
     }
@@ -1,112 +1,412 @@
 #define _USE_MATH_DEFINES
 
 #include "tasks.h"
+#include "CurveVisit.h"
+#include "Parallel.h"
+#include "RadixSort.h"
+#include <array>
+#include <optional>
 #include <random>
 #include <algorithm>
-#include <iostream>
 #include <cmath>
 
-void Task1_GenerateRandomCurves(std::vector<std::shared_ptr<Curve3D>>& curves, int count)
+namespace
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> typeDist(0, 2);
-    std::uniform_real_distribution<> paramDist(0.5, 5.0);
-    std::uniform_real_distribution<> posDist(-3.0, 3.0);
+    uint64_t Mix(uint64_t x)
+    {
+        // SplitMix64 finalizer
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
 
-    curves.clear();
-    for (int i = 0; i < count; ++i)
+    // Counter-based stream: curve i draws from SplitMix64 started at a hash of
+    // (seed, i), so it comes out the same whichever thread generates it
+    class CurveRandom
     {
-        int type = typeDist(gen);
-        Point3D pos(posDist(gen), posDist(gen), posDist(gen));
+    public:
+        CurveRandom(uint64_t seed, uint64_t index) : state(Mix(seed ^ Mix(index))) {}
 
-        switch (type)
+        uint64_t next()
         {
-        case 0: // Circle
+            state += 0x9e3779b97f4a7c15ull;
+            return Mix(state);
+        }
+
+        double uniform(double lo, double hi)
         {
-            double radius = paramDist(gen);
-            auto circle = std::make_shared<Circle3D>(radius);
-            circle->setPosition(pos);
-            curves.push_back(circle);
-            break;
+            return lo + (hi - lo) * ((next() >> 11) * 0x1.0p-53);
         }
-        case 1: // Ellipse
+
+        // Uniform in [lo, hi]
+        int uniformInt(int lo, int hi)
         {
-            double a = paramDist(gen);
-            double b = paramDist(gen);
-            auto ellipse = std::make_shared<Ellipse3D>(a, b);
-            ellipse->setPosition(pos);
-            curves.push_back(ellipse);
-            break;
+            uint64_t range = (uint64_t)(hi - lo) + 1;
+            return lo + (int)(((next() >> 32) * range) >> 32);
         }
-        case 2: // Helix
+
+    private:
+        uint64_t state;
+    };
+
+    struct RandomCurve
+    {
+        CurveKind kind;
+        Point3D position;
+        double radius; // circle and helix radius, ellipse a
+        double b;      // ellipse b, helix step
+        int turns;
+    };
+
+    // The kind is the first draw of a curve's stream, so it can be had alone
+    CurveKind DrawKind(CurveRandom& random)
+    {
+        return (CurveKind)random.uniformInt(0, 2);
+    }
+
+    RandomCurve DrawCurve(uint64_t seed, size_t index)
+    {
+        CurveRandom random(seed, index);
+        RandomCurve curve;
+        curve.kind = DrawKind(random);
+        curve.position.x = random.uniform(-3.0, 3.0);
+        curve.position.y = random.uniform(-3.0, 3.0);
+        curve.position.z = random.uniform(-3.0, 3.0);
+        curve.radius = random.uniform(0.5, 5.0);
+        curve.b = 0.0;
+        curve.turns = 0;
+        switch (curve.kind)
         {
-            double radius = paramDist(gen);
-            double step = paramDist(gen) * 0.5;
-            int turns = std::uniform_int_distribution<>(3, 8)(gen);
-            auto helix = std::make_shared<Helix3D>(radius, step, turns);
-            helix->setPosition(pos);
-            curves.push_back(helix);
+        case CurveKind::Circle:
+            break;
+        case CurveKind::Ellipse:
+            curve.b = random.uniform(0.5, 5.0);
+            break;
+        case CurveKind::Helix:
+            curve.b = random.uniform(0.5, 5.0) * 0.5;
+            curve.turns = random.uniformInt(3, 8);
             break;
         }
+        return curve;
+    }
+
+    template <class T, class... Args>
+    std::shared_ptr<T> Make(CurveArena::Local* arena, Args&&... args)
+    {
+        return arena ? arena->make<T>(std::forward<Args>(args)...) : std::make_shared<T>(std::forward<Args>(args)...);
+    }
+
+    std::shared_ptr<Curve3D> MakeCurve(const RandomCurve& r, CurveArena::Local* arena)
+    {
+        std::shared_ptr<Curve3D> curve;
+        switch (r.kind)
+        {
+        case CurveKind::Circle: curve = Make<Circle3D>(arena, r.radius); break;
+        case CurveKind::Ellipse: curve = Make<Ellipse3D>(arena, r.radius, r.b); break;
+        case CurveKind::Helix: curve = Make<Helix3D>(arena, r.radius, r.b, r.turns); break;
         }
+        curve->setPosition(r.position);
+        return curve;
+    }
+
+    uint64_t RandomSeed()
+    {
+        std::random_device rd;
+        return ((uint64_t)rd() << 32) ^ rd();
     }
 }
 
-void Task3_PrintPointsAndDerivatives(const std::vector<std::shared_ptr<Curve3D>>& curves)
+void Task1_GenerateRandomCurves(std::vector<std::shared_ptr<Curve3D>>& curves, int count, CurveArena* arena)
+{
+    Task1_GenerateRandomCurves(curves, count, RandomSeed(), 0, arena);
+}
+
+void Task1_GenerateRandomCurves(CurveSet& curves, int count)
+{
+    Task1_GenerateRandomCurves(curves, count, RandomSeed());
+}
+
+void Task1_GenerateRandomCurves(std::vector<std::shared_ptr<Curve3D>>& curves, int count, uint64_t seed, unsigned threads,
+    CurveArena* arena)
 {
-    std::cout << "=== Points and Derivatives at t = PI/4 ===" << std::endl;
-    double t = M_PI / 4.0;
+    size_t n = count > 0 ? (size_t)count : 0;
+    curves.clear();
+    curves.resize(n);
+    ParallelFor(n, threads, ParallelChunk, [&](size_t begin, size_t end) {
+        // A heap per range, so the ranges do not contend for the arena
+        std::optional<CurveArena::Local> local;
+        if (arena)
+            local.emplace(*arena);
+        for (size_t i = begin; i < end; ++i)
+            curves[i] = MakeCurve(DrawCurve(seed, i), local ? &*local : nullptr);
+    });
+}
+
+void Task1_GenerateRandomCurves(CurveSet& curves, int count, uint64_t seed, unsigned threads)
+{
+    size_t n = count > 0 ? (size_t)count : 0;
+    size_t chunks = (n + ParallelChunk - 1) / ParallelChunk;
+
+    // Pass 1: the kind of every curve and how many of each kind every chunk holds
+    std::vector<CurveKind> kinds(n);
+    std::vector<std::array<uint32_t, 3>> chunkRows(chunks);
+    ParallelFor(chunks, threads, 1, [&](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk)
+        {
+            std::array<uint32_t, 3> counts{};
+            size_t end = std::min(n, (chunk + 1) * ParallelChunk);
+            for (size_t i = chunk * ParallelChunk; i < end; ++i)
+            {
+                CurveRandom random(seed, i);
+                kinds[i] = DrawKind(random);
+                ++counts[(int)kinds[i]];
+            }
+            chunkRows[chunk] = counts;
+        }
+    });
 
-    for (int i = 0; i < curves.size(); ++i)
+    // Exclusive prefix sums turn the counts into each chunk's first row per kind,
+    // the same rows assign() hands out
+    std::array<uint32_t, 3> nextRow{};
+    for (std::array<uint32_t, 3>& rows : chunkRows)
     {
-        std::cout << "Curve " << i + 1 << ": ";
-        if (auto circle = std::dynamic_pointer_cast<Circle3D>(curves[i]))
-            std::cout << "Circle (r=" << circle->getRadius() << ")";
-        else if (auto ellipse = std::dynamic_pointer_cast<Ellipse3D>(curves[i]))
-            std::cout << "Ellipse (a=" << ellipse->getA() << ", b=" << ellipse->getB() << ")";
-        else if (auto helix = std::dynamic_pointer_cast<Helix3D>(curves[i]))
-            std::cout << "Helix (r=" << helix->getRadius() << ", step=" << helix->getStep() << ", turns=" << helix->getTurns() << ")";
-
-        Point3D point = curves[i]->getPoint(t);
-        Point3D derivative = curves[i]->getDerivative(t);
-
-        std::cout << "\n  Point: " << point;
-        std::cout << "\n  Derivative: " << derivative << std::endl << std::endl;
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t chunkCount = rows[k];
+            rows[k] = nextRow[k];
+            nextRow[k] += chunkCount;
+        }
     }
+
+    curves.assign(kinds);
+
+    // Pass 2: every chunk fills its own rows straight into the columns
+    CurveSet::CircleColumns& circles = curves.writableCircles();
+    CurveSet::EllipseColumns& ellipses = curves.writableEllipses();
+    CurveSet::HelixColumns& helices = curves.writableHelices();
+    ParallelFor(chunks, threads, 1, [&](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk)
+        {
+            std::array<uint32_t, 3> rows = chunkRows[chunk];
+            size_t end = std::min(n, (chunk + 1) * ParallelChunk);
+            for (size_t i = chunk * ParallelChunk; i < end; ++i)
+            {
+                RandomCurve r = DrawCurve(seed, i);
+                uint32_t row = rows[(int)r.kind]++;
+                CurveSet::Columns* columns = nullptr;
+                switch (r.kind)
+                {
+                case CurveKind::Circle:
+                    circles.radius[row] = r.radius;
+                    columns = &circles;
+                    break;
+                case CurveKind::Ellipse:
+                    ellipses.a[row] = r.radius;
+                    ellipses.b[row] = r.b;
+                    columns = &ellipses;
+                    break;
+                case CurveKind::Helix:
+                    helices.radius[row] = r.radius;
+                    helices.step[row] = r.b;
+                    helices.turns[row] = r.turns;
+                    columns = &helices;
+                    break;
+                }
+                columns->position[row] = r.position;
+                columns->transform[row].setTranslation(r.position);
+            }
+        }
+    });
 }
 
-void Task4_5_6_CirclesOperations(const std::vector<std::shared_ptr<Curve3D>>& curves)
+namespace
 {
-    // Task 4: Create second container with circles only
-    std::vector<std::shared_ptr<Circle3D>> circles;
-    for (const auto& curve : curves)
+    void WriteTask3Header(OutputWriter& out, double t)
     {
-        if (auto circle = std::dynamic_pointer_cast<Circle3D>(curve))
+        if (out.format() == OutputFormat::Csv)
+            out << "curve,type,t,x,y,z,dx,dy,dz\n";
+        else
+            out << "=== Points and Derivatives at t = " << t << " ===\n";
+    }
+
+    // describe(out) writes the type and parameters of the curve in text mode
+    template <class Describe>
+    void WriteTask3Record(OutputWriter& out, size_t number, CurveKind kind, double t,
+        const Point3D& point, const Point3D& derivative, Describe&& describe)
+    {
+        if (out.format() == OutputFormat::Csv)
         {
-            circles.push_back(circle);
+            out << number << ',' << CurveKindName(kind) << ',' << t << ',' << point << ',' << derivative << '\n';
+            return;
         }
+        out << "Curve " << number << ": ";
+        describe(out);
+        out << "\n  Point: " << point;
+        out << "\n  Derivative: " << derivative << "\n\n";
     }
+}
+
+void Task3_PrintPointsAndDerivatives(const std::vector<std::shared_ptr<Curve3D>>& curves)
+{
+    OutputWriter out;
+    Task3_WritePointsAndDerivatives(curves, M_PI / 4.0, out);
+}
+
+void Task3_WritePointsAndDerivatives(const std::vector<std::shared_ptr<Curve3D>>& curves, double t, OutputWriter& out)
+{
+    WriteTask3Header(out, t);
+    for (size_t i = 0; i < curves.size(); ++i)
+    {
+        const Curve3D& curve = *curves[i];
+        CurveSample sample = curve.evaluate(t, 1);
+        WriteTask3Record(out, i + 1, curve.kind(), t, sample.point, sample.derivative,
+            [&](OutputWriter& text) { WriteCurveDescription(text, curve); });
+    }
+}
+
+void Task3_WritePointsAndDerivatives(const CurveSet& curves, double t, OutputWriter& out)
+{
+    WriteTask3Header(out, t);
+    std::vector<CurveHandle> handles = curves.handles();
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        CurveHandle handle = handles[i];
+        CurveKind kind = curves.kind(handle);
+        size_t row = curves.row(handle);
+        CurveSample sample = curves.evaluate(handle, t, 1);
+        WriteTask3Record(out, i + 1, kind, t, sample.point, sample.derivative,
+            [&](OutputWriter& text) {
+                switch (kind)
+                {
+                case CurveKind::Circle:
+                    text << "Circle (r=" << curves.circles().radius[row] << ")";
+                    break;
+                case CurveKind::Ellipse:
+                    text << "Ellipse (a=" << curves.ellipses().a[row] << ", b=" << curves.ellipses().b[row] << ")";
+                    break;
+                case CurveKind::Helix:
+                    text << "Helix (r=" << curves.helices().radius[row] << ", step=" << curves.helices().step[row]
+                        << ", turns=" << curves.helices().turns[row] << ")";
+                    break;
+                }
+            });
+    }
+}
+
+void WriteCurveDescription(OutputWriter& out, const Curve3D& curve)
+{
+    VisitCurve(curve, Overloaded{
+        [&](const Circle3D& circle) { out << "Circle (r=" << circle.getRadius() << ")"; },
+        [&](const Ellipse3D& ellipse) { out << "Ellipse (a=" << ellipse.getA() << ", b=" << ellipse.getB() << ")"; },
+        [&](const Helix3D& helix) { out << "Helix (r=" << helix.getRadius() << ", step=" << helix.getStep() << ", turns=" << helix.getTurns() << ")"; } });
+}
+
+std::vector<std::shared_ptr<Circle3D>> Task4_CollectCircles(const std::vector<std::shared_ptr<Curve3D>>& curves, unsigned threads)
+{
+    std::vector<std::shared_ptr<Circle3D>> circles;
+    ParallelCompact(curves, circles, threads,
+        [](const std::shared_ptr<Curve3D>& curve) { return curve->kind() == CurveKind::Circle; },
+        [](const std::shared_ptr<Curve3D>& curve) { return std::static_pointer_cast<Circle3D>(curve); });
+    return circles;
+}
+
+// Key-index sort: the radii are gathered into one array and radix sorted as
+// integers, so the sort itself neither chases pointers nor moves shared_ptrs
+std::vector<uint32_t> Task5_OrderByRadius(const std::vector<std::shared_ptr<Circle3D>>& circles, unsigned threads)
+{
+    std::vector<double> radii(circles.size());
+    ParallelFor(circles.size(), threads, ParallelChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            radii[i] = circles[i]->getRadius();
+    });
+    return RadixSortOrder(radii, threads);
+}
+
+void Task5_SortByRadius(std::vector<std::shared_ptr<Circle3D>>& circles, unsigned threads)
+{
+    std::vector<uint32_t> order = Task5_OrderByRadius(circles, threads);
+
+    // Every circle moves once, straight to its final place
+    std::vector<std::shared_ptr<Circle3D>> sorted(circles.size());
+    ParallelFor(circles.size(), threads, ParallelChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            sorted[i] = std::move(circles[order[i]]);
+    });
+    circles.swap(sorted);
+}
+
+double Task6_SumOfRadii(const std::vector<std::shared_ptr<Circle3D>>& circles, unsigned threads)
+{
+    return ParallelSum(circles.size(), threads, [&](size_t i) { return circles[i]->getRadius(); });
+}
+
+// Circles already live in their own columns, only the radii are needed
+std::vector<double> Task4_CollectRadii(const CurveSet& curves)
+{
+    return curves.circles().radius;
+}
+
+void Task5_SortRadii(std::vector<double>& radii, unsigned threads)
+{
+    RadixSort(radii, threads);
+}
+
+double Task6_SumOfRadii(const std::vector<double>& radii, unsigned threads)
+{
+    return ParallelSum(radii.size(), threads, [&](size_t i) { return radii[i]; });
+}
+
+void Task4_5_6_CirclesOperations(const std::vector<std::shared_ptr<Curve3D>>& curves)
+{
+    // Task 4: Create second container with circles only
+    std::vector<std::shared_ptr<Circle3D>> circles = Task4_CollectCircles(curves);
 
     // Task 5: Sort by radius
-    std::sort(circles.begin(), circles.end(),
-        [](const std::shared_ptr<Circle3D>& a, const std::shared_ptr<Circle3D>& b) {
-            return a->getRadius() < b->getRadius();
-        });
+    Task5_SortByRadius(circles);
 
     // Task 6: Calculate sum of radii
-    double sum = 0.0;
+    double sum = Task6_SumOfRadii(circles);
+
+    OutputWriter out;
+    out << "=== Circle Operations ===\n";
+    out << "Found " << circles.size() << " circles\n";
+    out << "Sorted radii: ";
     for (const auto& circle : circles)
     {
-        sum += circle->getRadius();
+        out << circle->getRadius() << ' ';
     }
+    out << "\nSum of radii: " << sum << '\n';
+}
 
-    std::cout << "=== Circle Operations ===" << std::endl;
-    std::cout << "Found " << circles.size() << " circles" << std::endl;
-    std::cout << "Sorted radii: ";
-    for (const auto& circle : circles)
+void Task4_5_6_CirclesOperations(const CurveSet& curves)
+{
+    // Task 4: Collect circle radii
+    std::vector<double> radii = Task4_CollectRadii(curves);
+
+    // Task 5: Sort by radius
+    Task5_SortRadii(radii);
+
+    // Task 6: Calculate sum of radii
+    double sum = Task6_SumOfRadii(radii);
+
+    OutputWriter out;
+    out << "=== Circle Operations ===\n";
+    out << "Found " << radii.size() << " circles\n";
+    out << "Sorted radii: ";
+    for (double radius : radii)
     {
-        std::cout << circle->getRadius() << " ";
+        out << radius << ' ';
     }
-    std::cout << "\nSum of radii: " << sum << std::endl;
+    out << "\nSum of radii: " << sum << '\n';
+}
+
+void Task4_5_6_CirclesOperations(const RadiusIndex& circles)
+{
+    OutputWriter out;
+    out << "=== Circle Operations ===\n";
+    out << "Found " << circles.size() << " circles\n";
+    out << "Sorted radii: ";
+    circles.forEach([&](const RadiusIndex::Entry& circle) { out << circle.radius << ' '; });
+    out << "\nSum of radii: " << circles.sum() << '\n';
 }
\ No newline at end of file
@@ -4,9 +4,49 @@
 #include "Helix.h"
 #include "Circle.h"
 #include "Ellipse.h"
+#include "CurveSet.h"
+#include "RadiusIndex.h"
+#include "CurveArena.h"
+#include "OutputWriter.h"
+#include <cstdint>
 #include <vector>
 #include <memory>
 
-void Task1_GenerateRandomCurves(std::vector<std::shared_ptr<Curve3D>>& curves, int count = 10);
+// With an arena the curves are allocated from it instead of by make_shared
+void Task1_GenerateRandomCurves(std::vector<std::shared_ptr<Curve3D>>& curves, int count = 10, CurveArena* arena = nullptr);
 void Task3_PrintPointsAndDerivatives(const std::vector<std::shared_ptr<Curve3D>>& curves);
-void Task4_5_6_CirclesOperations(const std::vector<std::shared_ptr<Curve3D>>& curves);
\ No newline at end of file
+// Task 3 at any t into a writer: in text mode the listing printed above, in
+// CSV mode a header and one row per curve (curve,type,t,x,y,z,dx,dy,dz)
+void Task3_WritePointsAndDerivatives(const std::vector<std::shared_ptr<Curve3D>>& curves, double t, OutputWriter& out);
+void Task3_WritePointsAndDerivatives(const CurveSet& curves, double t, OutputWriter& out);
+// "Circle (r=...)" and the like, as Task 3 labels curves
+void WriteCurveDescription(OutputWriter& out, const Curve3D& curve);
+void Task4_5_6_CirclesOperations(const std::vector<std::shared_ptr<Curve3D>>& curves);
+
+// The same tasks on the column store, for scenes too large for one object per curve
+void Task1_GenerateRandomCurves(CurveSet& curves, int count = 10);
+void Task4_5_6_CirclesOperations(const CurveSet& curves);
+// Prints from an index kept up to date as curves change: nothing is collected,
+// sorted or summed here
+void Task4_5_6_CirclesOperations(const RadiusIndex& circles);
+
+// Reproducible Task1: curve i depends only on (seed, i), so the scene is the
+// same for any thread count. The overloads above draw a fresh seed.
+// threads = 0 uses every hardware thread.
+void Task1_GenerateRandomCurves(std::vector<std::shared_ptr<Curve3D>>& curves, int count, uint64_t seed, unsigned threads = 0,
+    CurveArena* arena = nullptr);
+void Task1_GenerateRandomCurves(CurveSet& curves, int count, uint64_t seed, unsigned threads = 0);
+
+// Computation behind Task4_5_6_CirclesOperations without the console output.
+// Each step runs on `threads` threads (0 = all) and returns the same result
+// for any thread count: the filter keeps the input order, the sort is a
+// stable radix sort and the sum is compensated and combined over fixed chunks.
+std::vector<std::shared_ptr<Circle3D>> Task4_CollectCircles(const std::vector<std::shared_ptr<Curve3D>>& curves, unsigned threads = 0);
+// Permutation that orders circles by radius; the circles themselves are not touched
+std::vector<uint32_t> Task5_OrderByRadius(const std::vector<std::shared_ptr<Circle3D>>& circles, unsigned threads = 0);
+void Task5_SortByRadius(std::vector<std::shared_ptr<Circle3D>>& circles, unsigned threads = 0);
+double Task6_SumOfRadii(const std::vector<std::shared_ptr<Circle3D>>& circles, unsigned threads = 0);
+
+std::vector<double> Task4_CollectRadii(const CurveSet& curves);
+void Task5_SortRadii(std::vector<double>& radii, unsigned threads = 0);
+double Task6_SumOfRadii(const std::vector<double>& radii, unsigned threads = 0);
\ No newline at end of file